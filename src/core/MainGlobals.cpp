@@ -565,7 +565,7 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
           if (c)
           {
             glm::ivec3 local = worldToLocal(hit->blockPos.x, hit->blockPos.y, hit->blockPos.z);
-            skyLight = static_cast<float>(c->skyLight[blockIndex(local.x, local.y, local.z)]) / static_cast<float>(MAX_SKY_LIGHT);
+            skyLight = static_cast<float>(c->skyLightAt(local.x, local.y, local.z)) / static_cast<float>(MAX_SKY_LIGHT);
           }
         }
         glm::vec4 particleTint(1.0f);
@@ -30,6 +30,11 @@ void Renderer::init()
     fogDensityLoc = glGetUniformLocation(shaderProgram->ID, "fogDensity");
     ambientLightLoc = glGetUniformLocation(shaderProgram->ID, "ambientLight");
 
+    glm::vec3 tintPalette[TINT_PALETTE_SIZE];
+    buildTintPalette(tintPalette);
+    glUniform3fv(glGetUniformLocation(shaderProgram->ID, "tintPalette"),
+                 TINT_PALETTE_SIZE, glm::value_ptr(tintPalette[0]));
+
     stbi_set_flip_vertically_on_load(false);
 
     glGenTextures(1, &textureArray);
@@ -277,6 +282,7 @@ void Renderer::cleanup()
     glDeleteVertexArrays(1, &faceVAO);
     glDeleteBuffers(1, &faceVBO);
     glDeleteBuffers(1, &faceEBO);
+    releaseQuadIndexBuffer();
 
     if (selectionShader) selectionShader->Delete();
     if (destroyShader) destroyShader->Delete();
@@ -491,7 +497,7 @@ void Renderer::renderDestroyOverlay(const FrameParams& fp, const Player& player,
             glm::ivec3 local = worldToLocal(player.breakingBlockPos.x,
                                              player.breakingBlockPos.y,
                                              player.breakingBlockPos.z);
-            skyLightVal = static_cast<float>(c->skyLight[blockIndex(local.x, local.y, local.z)])
+            skyLightVal = static_cast<float>(c->skyLightAt(local.x, local.y, local.z))
                         / static_cast<float>(MAX_SKY_LIGHT);
         }
     }
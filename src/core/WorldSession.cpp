@@ -133,16 +133,23 @@ void WorldSession::shutdown(Player& player, GLFWwindow* window)
         Chunk* chunk = pair.second.get();
         if (!chunk->dirtyData)
             continue;
+        BlockID blocks[CHUNK_VOLUME];
+        chunk->blocks.decode(blocks);
+        uint8_t light[CHUNK_VOLUME];
+        bool saveLight = chunkManager->lightSettled(*chunk);
+        if (saveLight)
+            chunk->light.decode(light);
         regionManager->saveChunkData(
-            chunk->position.x, chunk->position.y, chunk->position.z, chunk->blocks);
+            chunk->position.x, chunk->position.y, chunk->position.z, blocks, saveLight ? light : nullptr);
     }
     regionManager->flush();
+    regionManager->compact();
 
     player.inventory.heldItem.clear();
     player.inventory.saveToFile("saves/" + currentWorldName + "/inventory.dat");
     inventoryOpen = false;
 
-    chunkManager->chunks.clear();
+    chunkManager->clearChunks();
 
     g_chunkManager = nullptr;
     g_waterSimulator = nullptr;
@@ -42,6 +42,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <glm/glm.hpp>
@@ -142,8 +143,7 @@ int main(int argc, char* argv[])
     auto& waterSimulator = session.waterSimulator;
     auto& regionManager  = session.regionManager;
     auto& selectedBlock  = session.selectedBlock;
-    std::vector<glm::ivec2> loadOffsets;
-    int cachedLoadRadius = -1;
+    std::vector<Chunk*> meshCandidates;
 
     while (!glfwWindowShouldClose(window))
     {
@@ -502,28 +502,9 @@ int main(int argc, char* argv[])
 
         const int LOAD_RADIUS = renderDistance;
         const int UNLOAD_RADIUS = LOAD_RADIUS + 2;
-        const int CHUNK_HEIGHT_MIN = 0;
-        const int CHUNK_HEIGHT_MAX = (256 / CHUNK_SIZE) - 1;
-        if (cachedLoadRadius != LOAD_RADIUS)
-        {
-          loadOffsets.clear();
-          for (int dx = -LOAD_RADIUS; dx <= LOAD_RADIUS; dx++)
-          {
-            for (int dz = -LOAD_RADIUS; dz <= LOAD_RADIUS; dz++)
-            {
-              loadOffsets.push_back({dx, dz});
-            }
-          }
-          std::sort(loadOffsets.begin(), loadOffsets.end(),
-              [](const glm::ivec2& a, const glm::ivec2& b)
-              {
-                int da = a.x * a.x + a.y * a.y;
-                int db = b.x * b.x + b.y * b.y;
-                return da < db;
-              });
-          cachedLoadRadius = LOAD_RADIUS;
-        }
-        size_t pendingJobs = jobSystem ? jobSystem->pendingJobCount() : 0;
+        int playerCy = static_cast<int>(std::floor(player.position.y / CHUNK_SIZE));
+        chunkManager->setStreamingFocus(glm::ivec3(cx, playerCy, cz), UNLOAD_RADIUS);
+        size_t pendingJobs = chunkManager->pendingJobCount();
         int maxLoadEnqueuePerFrame = 32;
         int maxMeshEnqueuePerFrame = 16;
         if (pendingJobs > 200)
@@ -548,104 +529,15 @@ int main(int argc, char* argv[])
         }
 
         if (currentState == GameState::Playing)
-        {
-          int enqueuedLoads = 0;
-          for (const glm::ivec2& offset : loadOffsets)
-          {
-            if (useAsyncLoading && enqueuedLoads >= maxLoadEnqueuePerFrame)
-              break;
-            int chunkX = cx + offset.x;
-            int chunkZ = cz + offset.y;
-            for (int cy = CHUNK_HEIGHT_MIN; cy <= CHUNK_HEIGHT_MAX; cy++)
-            {
-              if (useAsyncLoading && enqueuedLoads >= maxLoadEnqueuePerFrame)
-                break;
-              if (!chunkManager->hasChunk(chunkX, cy, chunkZ) &&
-                  !chunkManager->isLoading(chunkX, cy, chunkZ) &&
-                  !chunkManager->isSaving(chunkX, cy, chunkZ))
-              {
-                if (useAsyncLoading)
-                {
-                  chunkManager->enqueueLoadChunk(chunkX, cy, chunkZ);
-                  enqueuedLoads++;
-                }
-                else
-                  chunkManager->loadChunk(chunkX, cy, chunkZ);
-              }
-            }
-          }
+          chunkManager->updateStreaming(LOAD_RADIUS, useAsyncLoading, maxLoadEnqueuePerFrame);
 
-          std::vector<ChunkManager::ChunkCoord> toUnload;
-          for (auto& pair : chunkManager->chunks)
-          {
-            Chunk* chunk = pair.second.get();
-            int distX = chunk->position.x - cx;
-            int distZ = chunk->position.z - cz;
-            if (std::abs(distX) > UNLOAD_RADIUS || std::abs(distZ) > UNLOAD_RADIUS)
-            {
-              if (!chunkManager->isSaving(chunk->position.x, chunk->position.y, chunk->position.z))
-                toUnload.push_back({chunk->position.x, chunk->position.y, chunk->position.z});
-            }
-          }
-          for (const auto& coord : toUnload)
-          {
-            if (useAsyncLoading)
-              chunkManager->enqueueSaveAndUnload(coord.x, coord.y, coord.z);
-            else
-              chunkManager->unloadChunk(coord.x, coord.y, coord.z);
-          }
-        }
-
-        std::vector<std::pair<int, Chunk*>> meshCandidates;
-        meshCandidates.reserve(chunkManager->chunks.size());
-        for (auto& pair : chunkManager->chunks)
-        {
-          Chunk* chunk = pair.second.get();
-          if (chunk->dirtyMesh && !chunkManager->isMeshing(chunk->position.x, chunk->position.y, chunk->position.z))
-          {
-            bool neighborsReady = true;
-            for (int i = 0; i < 6; i++)
-            {
-              int nx = chunk->position.x + DIRS[i].x;
-              int ny = chunk->position.y + DIRS[i].y;
-              int nz = chunk->position.z + DIRS[i].z;
-              if (ny >= CHUNK_HEIGHT_MIN && ny <= CHUNK_HEIGHT_MAX)
-              {
-                if (!chunkManager->hasChunk(nx, ny, nz))
-                {
-                  if (chunkManager->isLoading(nx, ny, nz))
-                  {
-                    neighborsReady = false;
-                    break;
-                  }
-                }
-              }
-            }
-
-            if (neighborsReady)
-            {
-              int dx = chunk->position.x - cx;
-              int dz = chunk->position.z - cz;
-              int dist2 = dx * dx + dz * dz;
-              meshCandidates.push_back({dist2, chunk});
-            }
-          }
-        }
-        std::sort(meshCandidates.begin(), meshCandidates.end(),
-            [](const std::pair<int, Chunk*>& a, const std::pair<int, Chunk*>& b)
-            {
-              return a.first < b.first;
-            });
-        int enqueuedMeshes = 0;
-        for (const auto& candidate : meshCandidates)
+        size_t maxMeshes = useAsyncLoading ? static_cast<size_t>(maxMeshEnqueuePerFrame) : SIZE_MAX;
+        chunkManager->takeMeshCandidates(maxMeshes, meshCandidates);
+        for (Chunk* chunk : meshCandidates)
         {
-          Chunk* chunk = candidate.second;
           if (useAsyncLoading)
           {
-            if (enqueuedMeshes >= maxMeshEnqueuePerFrame)
-              break;
             chunkManager->enqueueMeshChunk(chunk->position.x, chunk->position.y, chunk->position.z);
-            enqueuedMeshes++;
           }
           else
           {
@@ -653,6 +545,7 @@ int main(int argc, char* argv[])
             chunk->dirtyMesh = false;
           }
         }
+        chunkManager->dispatchPendingJobs();
 
         renderer.renderChunks(fp, *chunkManager);
         renderer.renderWater(fp, *chunkManager);
@@ -701,7 +594,7 @@ int main(int argc, char* argv[])
                       if (c)
                       {
                         glm::ivec3 local = worldToLocal(hit->blockPos.x, hit->blockPos.y, hit->blockPos.z);
-                        skyLightVal = static_cast<float>(c->skyLight[blockIndex(local.x, local.y, local.z)]) / static_cast<float>(MAX_SKY_LIGHT);
+                        skyLightVal = static_cast<float>(c->skyLightAt(local.x, local.y, local.z)) / static_cast<float>(MAX_SKY_LIGHT);
                       }
                     }
                     glm::vec4 particleTint(1.0f);
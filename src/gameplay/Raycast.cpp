@@ -1,6 +1,7 @@
 #include "Raycast.h"
 #include "../world/ChunkManager.h"
 #include "../world/Chunk.h"
+#include "../world/LightUpdate.h"
 #include "../utils/BlockTypes.h"
 #include "../utils/CoordUtils.h"
 #include <cmath>
@@ -13,7 +14,7 @@ uint8_t getBlockAtWorld(int wx, int wy, int wz, ChunkManager& chunkManager)
     return 0;
 
   glm::ivec3 local = worldToLocal(wx, wy, wz);
-  return c->blocks[blockIndex(local.x, local.y, local.z)];
+  return c->blockAt(local.x, local.y, local.z);
 }
 
 void setBlockAtWorld(int wx, int wy, int wz, uint8_t blockId, ChunkManager& chunkManager)
@@ -24,11 +25,18 @@ void setBlockAtWorld(int wx, int wy, int wz, uint8_t blockId, ChunkManager& chun
     return;
 
   glm::ivec3 local = worldToLocal(wx, wy, wz);
-  c->blocks[blockIndex(local.x, local.y, local.z)] = blockId;
-  c->dirtyMesh = true;
-  c->dirtyLight = true;
+  c->blocks.set(blockIndex(local.x, local.y, local.z), blockId);
+  if (c->content != ChunkContent::Mixed)
+    c->classifyContent();
+  chunkManager.markMeshDirty(c);
   c->dirtyData = true;
 
+  // A chunk still waiting for its first light gets the edit with it; lit
+  // chunks are patched in place around the edited voxel.
+  bool relight = c->dirtyLight;
+  if (relight)
+    chunkManager.markLightDirty(c);
+
   for (int i = 0; i < 6; i++)
   {
     glm::ivec3 neighborLocal = local + DIRS[i];
@@ -37,15 +45,30 @@ void setBlockAtWorld(int wx, int wy, int wz, uint8_t blockId, ChunkManager& chun
                       neighborLocal.z < 0 || neighborLocal.z >= CHUNK_SIZE;
     if (onBoundary)
     {
-      glm::ivec3 neighborChunk = chunk + DIRS[i];
-      Chunk* neighbor = chunkManager.getChunk(neighborChunk.x, neighborChunk.y, neighborChunk.z);
+      Chunk* neighbor = c->neighbors[i];
       if (neighbor)
       {
-        neighbor->dirtyMesh = true;
-        neighbor->dirtyLight = true;
+        chunkManager.markMeshDirty(neighbor);
+        if (relight)
+          chunkManager.markLightDirty(neighbor);
       }
     }
   }
+
+  if (relight)
+    return;
+
+  std::vector<Chunk*> changed;
+  updateLightAfterEdit(chunkManager, glm::ivec3(wx, wy, wz), changed);
+  for (Chunk* chunk : changed)
+  {
+    chunkManager.markMeshDirty(chunk);
+    // Saved light has to follow the edit.
+    chunk->dirtyData = true;
+    // A relight in flight was computed from the old light; run it again.
+    if (chunkManager.isLighting(chunk->position.x, chunk->position.y, chunk->position.z))
+      chunkManager.markLightDirty(chunk);
+  }
 }
 
 std::optional<RaycastHit> raycastVoxel(
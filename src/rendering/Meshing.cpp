@@ -1,21 +1,30 @@
 #include "Meshing.h"
 #include "../utils/BlockTypes.h"
 #include "../world/ChunkManager.h"
-#include "../world/TerrainGenerator.h"
 #include "../world/WaterSimulator.h"
 #include <glad/glad.h>
+#include <algorithm>
 #include <cstddef>
-#include <queue>
+#include <vector>
 #include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-static const Vertex FACE_POS_X[4] = { {{1, 0, 0}, {1, 0}, 0, 1.0f, 1.0f}, {{1, 1, 0}, {1, 1}, 0, 1.0f, 1.0f}, {{1, 1, 1}, {0, 1}, 0, 1.0f, 1.0f}, {{1, 0, 1}, {0, 0}, 0, 1.0f, 1.0f} };
-static const Vertex FACE_NEG_X[4] = { {{0, 0, 1}, {1, 0}, 0, 1.0f, 1.0f}, {{0, 1, 1}, {1, 1}, 0, 1.0f, 1.0f}, {{0, 1, 0}, {0, 1}, 0, 1.0f, 1.0f}, {{0, 0, 0}, {0, 0}, 0, 1.0f, 1.0f} };
-static const Vertex FACE_POS_Y[4] = { {{0, 1, 0}, {1, 0}, 0, 1.0f, 1.0f}, {{0, 1, 1}, {1, 1}, 0, 1.0f, 1.0f}, {{1, 1, 1}, {0, 1}, 0, 1.0f, 1.0f}, {{1, 1, 0}, {0, 0}, 0, 1.0f, 1.0f} };
-static const Vertex FACE_NEG_Y[4] = { {{0, 0, 1}, {1, 0}, 0, 1.0f, 1.0f}, {{0, 0, 0}, {1, 1}, 0, 1.0f, 1.0f}, {{1, 0, 0}, {0, 1}, 0, 1.0f, 1.0f}, {{1, 0, 1}, {0, 0}, 0, 1.0f, 1.0f} };
-static const Vertex FACE_POS_Z[4] = { {{1, 0, 1}, {1, 0}, 0, 1.0f, 1.0f}, {{1, 1, 1}, {1, 1}, 0, 1.0f, 1.0f}, {{0, 1, 1}, {0, 1}, 0, 1.0f, 1.0f}, {{0, 0, 1}, {0, 0}, 0, 1.0f, 1.0f} };
-static const Vertex FACE_NEG_Z[4] = { {{0, 0, 0}, {1, 0}, 0, 1.0f, 1.0f}, {{0, 1, 0}, {1, 1}, 0, 1.0f, 1.0f}, {{1, 1, 0}, {0, 1}, 0, 1.0f, 1.0f}, {{1, 0, 0}, {0, 0}, 0, 1.0f, 1.0f} };
+struct FaceCorner
+{
+  glm::vec3 pos;
+  glm::vec2 uv;
+};
+
+static const FaceCorner FACE_POS_X[4] = { {{1, 0, 0}, {1, 0} }, {{1, 1, 0}, {1, 1} }, {{1, 1, 1}, {0, 1} }, {{1, 0, 1}, {0, 0} } };
+static const FaceCorner FACE_NEG_X[4] = { {{0, 0, 1}, {1, 0} }, {{0, 1, 1}, {1, 1} }, {{0, 1, 0}, {0, 1} }, {{0, 0, 0}, {0, 0} } };
+static const FaceCorner FACE_POS_Y[4] = { {{0, 1, 0}, {1, 0} }, {{0, 1, 1}, {1, 1} }, {{1, 1, 1}, {0, 1} }, {{1, 1, 0}, {0, 0} } };
+static const FaceCorner FACE_NEG_Y[4] = { {{0, 0, 1}, {1, 0} }, {{0, 0, 0}, {1, 1} }, {{1, 0, 0}, {0, 1} }, {{1, 0, 1}, {0, 0} } };
+static const FaceCorner FACE_POS_Z[4] = { {{1, 0, 1}, {1, 0} }, {{1, 1, 1}, {1, 1} }, {{0, 1, 1}, {0, 1} }, {{0, 0, 1}, {0, 0} } };
+static const FaceCorner FACE_NEG_Z[4] = { {{0, 0, 0}, {1, 0} }, {{0, 1, 0}, {1, 1} }, {{1, 1, 0}, {0, 1} }, {{1, 0, 0}, {0, 0} } };
 
-static const Vertex *FACE_TABLE[6] = {
+static const FaceCorner *FACE_TABLE[6] = {
     FACE_POS_X, FACE_NEG_X,
     FACE_POS_Y, FACE_NEG_Y,
     FACE_POS_Z, FACE_NEG_Z
@@ -25,8 +34,44 @@ static const uint32_t FACE_INDICES[6] = {
     0, 1, 2,
     0, 2, 3};
 
+static Vertex packVertex(const glm::vec3& pos, float u, float v, int tileIndex, int dir, uint8_t light, int tint)
+{
+  uint32_t x = static_cast<uint32_t>(pos.x);
+  uint32_t z = static_cast<uint32_t>(pos.z);
+  uint32_t y = static_cast<uint32_t>(std::lround(pos.y * VERTEX_Y_SCALE));
+  uint32_t pu = static_cast<uint32_t>(std::lround(u * VERTEX_UV_SCALE));
+  uint32_t pv = static_cast<uint32_t>(std::lround(v * VERTEX_UV_SCALE));
+
+  Vertex vtx;
+  vtx.positionTileFace = (x & 31u) | ((z & 31u) << 5) | ((y & 2047u) << 10) |
+                         ((static_cast<uint32_t>(tileIndex) & 255u) << 21) |
+                         (static_cast<uint32_t>(dir) << 29);
+  vtx.uvLightTint = (pu & 1023u) | ((pv & 1023u) << 10) |
+                    (static_cast<uint32_t>(light) << 20) |
+                    ((static_cast<uint32_t>(tint) & 15u) << 28);
+  return vtx;
+}
+
+// Palette slot 0 is untinted; each biome then has a grass and a foliage entry.
+static int biomeTintIndex(BiomeID biome, bool foliage)
+{
+  return 1 + static_cast<int>(biome) * 2 + (foliage ? 1 : 0);
+}
 
-static float getFluidHeight(BlockGetter getBlock, int cornerX, int cornerY, int cornerZ)
+void buildTintPalette(glm::vec3 (&palette)[TINT_PALETTE_SIZE])
+{
+  for (int i = 0; i < TINT_PALETTE_SIZE; i++)
+    palette[i] = glm::vec3(1.0f);
+
+  for (BiomeID biome : {BiomeID::Desert, BiomeID::Forest, BiomeID::Tundra, BiomeID::Plains})
+  {
+    palette[biomeTintIndex(biome, false)] = getBiomeGrassTint(biome);
+    palette[biomeTintIndex(biome, true)] = getBiomeFoliageTint(biome);
+  }
+}
+
+
+static float getFluidHeight(const PaddedChunkVolume& volume, int cornerX, int cornerY, int cornerZ)
 {
     int count = 0;
     float totalHeight = 0.0f;
@@ -37,8 +82,8 @@ static float getFluidHeight(BlockGetter getBlock, int cornerX, int cornerY, int
         int sampleX = cornerX - (j & 1);
         int sampleZ = cornerZ - ((j >> 1) & 1);
         
-        BlockID above = getBlock(sampleX, cornerY + 1, sampleZ);
-        BlockID block = getBlock(sampleX, cornerY, sampleZ);
+        BlockID above = volume.blockAt(sampleX, cornerY + 1, sampleZ);
+        BlockID block = volume.blockAt(sampleX, cornerY, sampleZ);
         
         if (isWater(block))
         {
@@ -75,11 +120,11 @@ static float getFluidHeight(BlockGetter getBlock, int cornerX, int cornerY, int
     return glm::clamp(height, 0.15f, 0.9f);
 }
 
-static glm::vec3 getFlowDirection(BlockGetter getBlock, int x, int y, int z)
+static glm::vec3 getFlowDirection(const PaddedChunkVolume& volume, int x, int y, int z)
 {
     glm::vec3 flow(0.0f);
     
-    BlockID currentBlock = getBlock(x, y, z);
+    BlockID currentBlock = volume.blockAt(x, y, z);
     if (!isWater(currentBlock))
         return flow;
     
@@ -93,14 +138,14 @@ static glm::vec3 getFlowDirection(BlockGetter getBlock, int x, int y, int z)
         int nx = x + dx[i];
         int nz = z + dz[i];
         
-        BlockID neighborBlock = getBlock(nx, y, nz);
+        BlockID neighborBlock = volume.blockAt(nx, y, nz);
         int neighborDepth = getRenderedDepth(neighborBlock);
         
         if (neighborDepth < 0)
         {
             if (!isBlockSolid(neighborBlock))
             {
-                BlockID belowNeighbor = getBlock(nx, y - 1, nz);
+                BlockID belowNeighbor = volume.blockAt(nx, y - 1, nz);
                 int belowDepth = getRenderedDepth(belowNeighbor);
                 if (belowDepth >= 0)
                 {
@@ -127,9 +172,9 @@ static glm::vec3 getFlowDirection(BlockGetter getBlock, int x, int y, int z)
     return flow;
 }
 
-static float getSlopeAngle(BlockGetter getBlock, int x, int y, int z)
+static float getSlopeAngle(const PaddedChunkVolume& volume, int x, int y, int z)
 {
-    glm::vec3 flow = getFlowDirection(getBlock, x, y, z);
+    glm::vec3 flow = getFlowDirection(volume, x, y, z);
     if (flow.x == 0.0f && flow.z == 0.0f)
         return -1000.0f;
     return std::atan2(flow.z, flow.x) - (3.14159265359f / 2.0f);
@@ -169,19 +214,215 @@ static WaterVertexUV calculateWaterUV(float angle)
     return uv;
 }
 
-static void buildGreedyMesh(
-    const BlockID* blocks,
-    const glm::ivec3& chunkWorldOrigin,
-    BlockGetter getBlock,
-    LightGetter getSkyLight,
-    std::vector<Vertex>& outVertices,
-    std::vector<uint32_t>& outIndices,
-    bool liquidsOnly = false)
+// Per-thread running estimate of recent mesh sizes. The mesher writes straight
+// into the caller's vector, reserved from this estimate rather than the worst
+// case, so each vertex is written once and pooled job vectors keep their
+// capacity between meshes.
+struct MeshSizeEstimate
 {
-  outVertices.clear();
-  outIndices.clear();
-  outVertices.reserve(CHUNK_VOLUME * 6 * 4);
-  outIndices.reserve(CHUNK_VOLUME * 6 * 6);
+  size_t estimatedQuads = 256;
+};
+
+static MeshSizeEstimate& meshSizeEstimate(bool liquidsOnly)
+{
+  thread_local MeshSizeEstimate opaqueEstimate;
+  thread_local MeshSizeEstimate liquidEstimate;
+  return liquidsOnly ? liquidEstimate : opaqueEstimate;
+}
+
+static int lowestBit(uint32_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(bits);
+#endif
+}
+
+static void emitQuad(
+    std::vector<Vertex>& vertices,
+    const PaddedChunkVolume& volume,
+    int dir, int i, int j, int k, int w, int h,
+    BlockID type, uint8_t light, float height,
+    bool liquid)
+{
+  glm::ivec3 n = DIRS[dir];
+  int axis = 0;
+  if (n.y != 0) axis = 1;
+  if (n.z != 0) axis = 2;
+
+  int u = (axis + 1) % 3;
+  int v = (axis + 2) % 3;
+
+  const FaceCorner *face = FACE_TABLE[dir];
+
+  int tileIndex = g_blockTypes[type].faceTexture[dir];
+  int rotation = g_blockTypes[type].faceRotation[dir];
+
+  int axisOffset = (n[axis] > 0) ? 1 : 0;
+  
+  glm::ivec3 blockWorldPos;
+  blockWorldPos[axis] = i;
+  blockWorldPos[u] = k;
+  blockWorldPos[v] = j;
+  
+  float flowAngle = -1000.0f;
+  if (liquid && dir == 2)
+  {
+      flowAngle = getSlopeAngle(volume, blockWorldPos.x, blockWorldPos.y, blockWorldPos.z);
+  }
+  WaterVertexUV waterUV = calculateWaterUV(flowAngle);
+
+  int blockX = blockWorldPos.x;
+  int blockY = blockWorldPos.y;
+  int blockZ = blockWorldPos.z;
+  int tint = 0;
+  if (g_blockTypes[type].faceTint[dir])
+  {
+      BiomeID biome = volume.biomes[blockZ * CHUNK_SIZE + blockX];
+      bool isLeaf = g_blockTypes[type].transparent && g_blockTypes[type].solid;
+      tint = biomeTintIndex(biome, isLeaf);
+  }
+
+  for (int vIdx = 0; vIdx < 4; vIdx++)
+  {
+    const FaceCorner& corner = face[vIdx];
+    glm::vec3 originalPos = corner.pos;
+    glm::vec3 finalPos;
+    bool isTopVertex = originalPos.y > 0.5f;
+    float vertexWaterHeight = height;
+
+    if (liquid)
+    {
+      finalPos.x = static_cast<float>(blockX) + originalPos.x;
+      finalPos.y = static_cast<float>(blockY) + originalPos.y;
+      finalPos.z = static_cast<float>(blockZ) + originalPos.z;
+      
+      if (dir == 2)
+      {
+        int cornerX = blockX + static_cast<int>(originalPos.x);
+        int cornerZ = blockZ + static_cast<int>(originalPos.z);
+        float cornerHeight = getFluidHeight(volume, cornerX, blockY, cornerZ);
+        finalPos.y = static_cast<float>(blockY) + cornerHeight - 0.01f;
+        vertexWaterHeight = cornerHeight;
+      }
+      else if (dir == 0 || dir == 1 || dir == 4 || dir == 5)
+      {
+        if (isTopVertex)
+        {
+          int cornerX = blockX + static_cast<int>(originalPos.x);
+          int cornerZ = blockZ + static_cast<int>(originalPos.z);
+          float cornerHeight = getFluidHeight(volume, cornerX, blockY, cornerZ);
+          finalPos.y = static_cast<float>(blockY) + cornerHeight - 0.01f;
+          vertexWaterHeight = cornerHeight;
+        }
+        else
+        {
+          finalPos.y = static_cast<float>(blockY);
+        }
+      }
+    }
+    else
+    {
+      finalPos[axis] = static_cast<float>(i + axisOffset);
+
+      if (corner.uv.x > 0.5f) finalPos[u] = static_cast<float>(k + w);
+      else finalPos[u] = static_cast<float>(k);
+
+      if (corner.uv.y > 0.5f) finalPos[v] = static_cast<float>(j + h);
+      else finalPos[v] = static_cast<float>(j);
+    }
+
+    float localU = (corner.uv.x > 0.5f) ? static_cast<float>(w) : 0.0f;
+    float localV = (corner.uv.y > 0.5f) ? static_cast<float>(h) : 0.0f;
+
+    if (liquid && dir == 2)
+    {
+        switch (vIdx)
+        {
+            case 0: localU = waterUV.u0; localV = waterUV.v0; break;
+            case 1: localU = waterUV.u1; localV = waterUV.v1; break;
+            case 2: localU = waterUV.u2; localV = waterUV.v2; break;
+            case 3: localU = waterUV.u3; localV = waterUV.v3; break;
+        }
+    }
+    else if (liquid && (dir == 0 || dir == 1 || dir == 4 || dir == 5))
+    {
+      localV = isTopVertex ? vertexWaterHeight : 0.0f;
+    }
+
+    if (!liquid)
+    {
+        switch (rotation)
+        {
+          case 1:
+            {
+              float tmp = localU;
+              localU = localV;
+              localV = static_cast<float>(w) - tmp;
+            }
+            break;
+          case 2:
+            localV = static_cast<float>(h) - localV;
+            break;
+          case 3:
+            {
+              float tmp = localU;
+              localU = static_cast<float>(h) - localV;
+              localV = tmp;
+            }
+            break;
+          default:
+            break;
+        }
+    }
+
+    vertices.push_back(packVertex(finalPos, localU, localV, tileIndex, dir, light, tint));
+  }
+}
+
+// Opaque faces are culled a whole column at a time. For each axis, every
+// (u, v) cell of the chunk keeps a bitmask running along that axis, where bit
+// p holds coordinate p - 1. Bits 0 and 17 are the neighbour chunks' boundary
+// layers. Visible faces are then merged row by row with bit scans, producing
+// the same quads in the same order as a per-voxel greedy scan.
+static void meshOpaqueFaces(
+    const PaddedChunkVolume& volume,
+    std::vector<Vertex>& vertices)
+{
+  const BlockID* padded = volume.blocks;
+  uint32_t present[3][CHUNK_SIZE][CHUNK_SIZE] = {};
+  uint32_t occluding[3][CHUNK_SIZE][CHUNK_SIZE] = {};
+  uint32_t transparent[3][CHUNK_SIZE][CHUNK_SIZE] = {};
+
+  auto classify = [&](int axis, int j, int k, int bit, BlockID id, bool interior)
+  {
+    if (id == 0 || g_blockTypes[id].isLiquid)
+      return;
+    if (interior)
+      present[axis][j][k] |= 1u << bit;
+    if (g_blockTypes[id].transparent)
+      transparent[axis][j][k] |= 1u << bit;
+    else
+      occluding[axis][j][k] |= 1u << bit;
+  };
+
+  for (int a = 0; a < CHUNK_SIZE; a++)
+  {
+    for (int b = 0; b < CHUNK_SIZE; b++)
+    {
+      for (int p = -1; p <= CHUNK_SIZE; p++)
+      {
+        bool interior = p >= 0 && p < CHUNK_SIZE;
+        // Axis order matches the greedy slice layout: u = axis + 1, v = axis + 2.
+        classify(0, b, a, p + 1, padded[PaddedChunkVolume::index(p, a, b)], interior);
+        classify(1, b, a, p + 1, padded[PaddedChunkVolume::index(b, p, a)], interior);
+        classify(2, b, a, p + 1, padded[PaddedChunkVolume::index(a, b, p)], interior);
+      }
+    }
+  }
 
   for (int dir = 0; dir < 6; dir++)
   {
@@ -192,416 +433,369 @@ static void buildGreedyMesh(
 
     int u = (axis + 1) % 3;
     int v = (axis + 2) % 3;
+    bool positive = n[axis] > 0;
 
-    BlockID mask[CHUNK_SIZE][CHUNK_SIZE];
-    uint8_t lightMask[CHUNK_SIZE][CHUNK_SIZE];
-    float heightMask[CHUNK_SIZE][CHUNK_SIZE];
+    uint16_t rows[CHUNK_SIZE][CHUNK_SIZE] = {};
+    bool anyFace = false;
 
-    for (int i = 0; i < CHUNK_SIZE; i++)
+    for (int j = 0; j < CHUNK_SIZE; j++)
     {
-      for (int j = 0; j < CHUNK_SIZE; j++)
+      for (int k = 0; k < CHUNK_SIZE; k++)
       {
-        for (int k = 0; k < CHUNK_SIZE; k++)
+        uint32_t solid = present[axis][j][k];
+        if (solid == 0)
+          continue;
+
+        uint32_t hidden = positive ? occluding[axis][j][k] >> 1 : occluding[axis][j][k] << 1;
+        uint32_t seeThrough = positive ? transparent[axis][j][k] >> 1 : transparent[axis][j][k] << 1;
+        uint32_t visible = solid & ~hidden;
+
+        // A transparent neighbour only hides the face when it is the same block.
+        uint32_t sameCheck = visible & seeThrough;
+        while (sameCheck)
         {
+          int bit = lowestBit(sameCheck);
+          sameCheck &= sameCheck - 1;
+
           glm::ivec3 pos;
-          pos[axis] = i;
+          pos[axis] = bit - 1;
           pos[u] = k;
           pos[v] = j;
+          glm::ivec3 npos = pos + n;
+          if (padded[PaddedChunkVolume::index(pos.x, pos.y, pos.z)] == padded[PaddedChunkVolume::index(npos.x, npos.y, npos.z)])
+            visible &= ~(1u << bit);
+        }
 
-          BlockID current = blocks[blockIndex(pos.x, pos.y, pos.z)];
-          bool isCurrentLiquid = g_blockTypes[current].isLiquid;
+        while (visible)
+        {
+          int bit = lowestBit(visible);
+          visible &= visible - 1;
+          rows[bit - 1][j] |= static_cast<uint16_t>(1u << k);
+          anyFace = true;
+        }
+      }
+    }
 
-          if (liquidsOnly != isCurrentLiquid)
-          {
-            mask[j][k] = 0;
-            lightMask[j][k] = 0;
-            heightMask[j][k] = 1.0f;
-            continue;
-          }
+    if (!anyFace)
+      continue;
 
-          glm::ivec3 npos = pos + n;
-          BlockID neighbor = getBlock(npos.x, npos.y, npos.z);
-          bool isNeighborLiquid = g_blockTypes[neighbor].isLiquid;
+    BlockID types[CHUNK_SIZE][CHUNK_SIZE];
+    uint8_t lights[CHUNK_SIZE][CHUNK_SIZE];
 
-          bool showFace = false;
-          float waterHeight = 1.0f;
+    for (int i = 0; i < CHUNK_SIZE; i++)
+    {
+      uint16_t* sliceRows = rows[i];
+
+      for (int j = 0; j < CHUNK_SIZE; j++)
+      {
+        uint32_t bits = sliceRows[j];
+        while (bits)
+        {
+          int k = lowestBit(bits);
+          bits &= bits - 1;
+
+          glm::ivec3 pos;
+          pos[axis] = i;
+          pos[u] = k;
+          pos[v] = j;
+          glm::ivec3 npos = pos + n;
+          types[j][k] = padded[PaddedChunkVolume::index(pos.x, pos.y, pos.z)];
+          lights[j][k] = volume.lightAt(npos.x, npos.y, npos.z);
+        }
+      }
 
-          if (current != 0)
+      for (int j = 0; j < CHUNK_SIZE; j++)
+      {
+        while (sliceRows[j])
+        {
+          int k = lowestBit(sliceRows[j]);
+          BlockID type = types[j][k];
+          uint8_t light = lights[j][k];
+
+          int w = 1;
+          while (k + w < CHUNK_SIZE && (sliceRows[j] & (1u << (k + w))) &&
+                 types[j][k + w] == type && lights[j][k + w] == light)
+            w++;
+
+          uint32_t span = ((1u << w) - 1u) << k;
+          int h = 1;
+          while (j + h < CHUNK_SIZE && (sliceRows[j + h] & span) == span)
           {
-            if (liquidsOnly)
-            {
-              if (dir == 2 && !isNeighborLiquid)
-              {
-                showFace = true;
-                waterHeight = getWaterHeight(current);
-                
-                BlockID above = getBlock(pos.x, pos.y + 1, pos.z);
-                if (isWater(above))
-                {
-                    showFace = false;
-                }
-              }
-              else if (dir != 2 && dir != 3)
-              {
-                if (!isNeighborLiquid && !isBlockSolid(neighbor))
-                {
-                  showFace = true;
-                  waterHeight = getWaterHeight(current);
-                }
-              }
-              else if (dir == 3)
-              {
-                if (!isNeighborLiquid && !isBlockSolid(neighbor))
-                {
-                  showFace = true;
-                }
-              }
-            }
-            else
+            bool match = true;
+            for (int dx = 0; dx < w; dx++)
             {
-              if (neighbor == 0)
-              {
-                showFace = true;
-              }
-              else if (isNeighborLiquid)
+              if (types[j + h][k + dx] != type || lights[j + h][k + dx] != light)
               {
-                showFace = true;
-              }
-              else if (isBlockTransparent(neighbor))
-              {
-                if (current == neighbor && g_blockTypes[current].connectsToSame)
-                {
-                  showFace = false;
-                }
-                else if (current != neighbor)
-                {
-                  showFace = true;
-                }
+                match = false;
+                break;
               }
             }
+            if (!match) break;
+            h++;
           }
 
-          mask[j][k] = showFace ? current : 0;
-          lightMask[j][k] = showFace ? getSkyLight(npos.x, npos.y, npos.z) : 0;
-          heightMask[j][k] = waterHeight;
+          for (int dy = 0; dy < h; dy++)
+            sliceRows[j + dy] = static_cast<uint16_t>(sliceRows[j + dy] & ~span);
+
+          emitQuad(vertices, volume, dir, i, j, k, w, h, type, light, 1.0f, false);
         }
       }
+    }
+  }
+}
+
+static void meshLiquidFaces(
+    const PaddedChunkVolume& volume,
+    std::vector<Vertex>& vertices)
+{
+  for (int dir = 0; dir < 6; dir++)
+  {
+    glm::ivec3 n = DIRS[dir];
+    int axis = 0;
+    if (n.y != 0) axis = 1;
+    if (n.z != 0) axis = 2;
+
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
 
+    for (int i = 0; i < CHUNK_SIZE; i++)
+    {
       for (int j = 0; j < CHUNK_SIZE; j++)
       {
         for (int k = 0; k < CHUNK_SIZE; k++)
         {
-          if (mask[j][k] != 0)
-          {
-            BlockID type = mask[j][k];
-            uint8_t light = lightMask[j][k];
-            float height = heightMask[j][k];
-            int w = 1;
-            int h = 1;
-
-            if (!liquidsOnly)
-            {
-              while (k + w < CHUNK_SIZE && mask[j][k + w] == type && lightMask[j][k + w] == light)
-                w++;
-
-              bool done = false;
-              while (j + h < CHUNK_SIZE)
-              {
-                for (int dx = 0; dx < w; dx++)
-                {
-                  if (mask[j + h][k + dx] != type || lightMask[j + h][k + dx] != light)
-                  {
-                    done = true;
-                    break;
-                  }
-                }
-                if (done) break;
-                h++;
-              }
-            }
+          glm::ivec3 pos;
+          pos[axis] = i;
+          pos[u] = k;
+          pos[v] = j;
 
-            const Vertex *face = FACE_TABLE[dir];
-            uint32_t baseIndex = static_cast<uint32_t>(outVertices.size());
+          BlockID current = volume.blockAt(pos.x, pos.y, pos.z);
+          if (current == 0 || !g_blockTypes[current].isLiquid)
+            continue;
 
-            int tileIndex = g_blockTypes[type].faceTexture[dir];
-            int rotation = g_blockTypes[type].faceRotation[dir];
+          glm::ivec3 npos = pos + n;
+          BlockID neighbor = volume.blockAt(npos.x, npos.y, npos.z);
+          bool isNeighborLiquid = g_blockTypes[neighbor].isLiquid;
 
-            float faceShade = FACE_SHADE[dir];
-            float skyLightNormalized = static_cast<float>(light) / static_cast<float>(MAX_SKY_LIGHT);
+          bool showFace = false;
+          float waterHeight = 1.0f;
 
-            int axisOffset = (n[axis] > 0) ? 1 : 0;
-            
-            glm::ivec3 blockWorldPos;
-            blockWorldPos[axis] = i;
-            blockWorldPos[u] = k;
-            blockWorldPos[v] = j;
+          if (dir == 2 && !isNeighborLiquid)
+          {
+            showFace = true;
+            waterHeight = getWaterHeight(current);
             
-            float flowAngle = -1000.0f;
-            if (liquidsOnly && dir == 2)
+            BlockID above = volume.blockAt(pos.x, pos.y + 1, pos.z);
+            if (isWater(above))
             {
-                flowAngle = getSlopeAngle(getBlock, blockWorldPos.x, blockWorldPos.y, blockWorldPos.z);
+                showFace = false;
             }
-            WaterVertexUV waterUV = calculateWaterUV(flowAngle);
-
-            int blockX = blockWorldPos.x;
-            int blockY = blockWorldPos.y;
-            int blockZ = blockWorldPos.z;
-            glm::vec3 biomeTint(1.0f);
-            if (g_blockTypes[type].faceTint[dir])
+          }
+          else if (dir != 2 && dir != 3)
+          {
+            if (!isNeighborLiquid && !isBlockSolid(neighbor))
             {
-                BiomeID biome = getBiomeAt(
-                    chunkWorldOrigin.x + blockX,
-                    chunkWorldOrigin.z + blockZ);
-                bool isLeaf = g_blockTypes[type].transparent && g_blockTypes[type].solid;
-                biomeTint = isLeaf
-                    ? getBiomeFoliageTint(biome)
-                    : getBiomeGrassTint(biome);
+              showFace = true;
+              waterHeight = getWaterHeight(current);
             }
-
-            for (int vIdx = 0; vIdx < 4; vIdx++)
+          }
+          else if (dir == 3)
+          {
+            if (!isNeighborLiquid && !isBlockSolid(neighbor))
             {
-              Vertex vtx = face[vIdx];
-              glm::vec3 originalPos = vtx.pos;
-              glm::vec3 finalPos;
-              bool isTopVertex = originalPos.y > 0.5f;
-              float vertexWaterHeight = height;
+              showFace = true;
+            }
+          }
 
-              if (liquidsOnly)
-              {
-                finalPos.x = static_cast<float>(blockX) + originalPos.x;
-                finalPos.y = static_cast<float>(blockY) + originalPos.y;
-                finalPos.z = static_cast<float>(blockZ) + originalPos.z;
-                
-                if (dir == 2)
-                {
-                  int cornerX = blockX + static_cast<int>(originalPos.x);
-                  int cornerZ = blockZ + static_cast<int>(originalPos.z);
-                  float cornerHeight = getFluidHeight(getBlock, cornerX, blockY, cornerZ);
-                  finalPos.y = static_cast<float>(blockY) + cornerHeight - 0.01f;
-                  vertexWaterHeight = cornerHeight;
-                }
-                else if (dir == 0 || dir == 1 || dir == 4 || dir == 5)
-                {
-                  if (isTopVertex)
-                  {
-                    int cornerX = blockX + static_cast<int>(originalPos.x);
-                    int cornerZ = blockZ + static_cast<int>(originalPos.z);
-                    float cornerHeight = getFluidHeight(getBlock, cornerX, blockY, cornerZ);
-                    finalPos.y = static_cast<float>(blockY) + cornerHeight - 0.01f;
-                    vertexWaterHeight = cornerHeight;
-                  }
-                  else
-                  {
-                    finalPos.y = static_cast<float>(blockY);
-                  }
-                }
-              }
-              else
-              {
-                finalPos[axis] = static_cast<float>(i + axisOffset);
+          if (showFace)
+          {
+            uint8_t light = volume.lightAt(npos.x, npos.y, npos.z);
+            emitQuad(vertices, volume, dir, i, j, k, 1, 1, current, light, waterHeight, true);
+          }
+        }
+      }
+    }
+  }
+}
 
-                if (vtx.uv.x > 0.5f) finalPos[u] = static_cast<float>(k + w);
-                else finalPos[u] = static_cast<float>(k);
+static void buildGreedyMesh(
+    const PaddedChunkVolume& volume,
+    std::vector<Vertex>& outVertices,
+    bool liquidsOnly = false)
+{
+  MeshSizeEstimate& estimate = meshSizeEstimate(liquidsOnly);
+  outVertices.clear();
 
-                if (vtx.uv.y > 0.5f) finalPos[v] = static_cast<float>(j + h);
-                else finalPos[v] = static_cast<float>(j);
-              }
+  // Let go of buffers left oversized by an unusually dense chunk.
+  size_t reserveQuads = estimate.estimatedQuads + estimate.estimatedQuads / 4;
+  if (outVertices.capacity() > reserveQuads * 4 * 4)
+    std::vector<Vertex>().swap(outVertices);
+  outVertices.reserve(reserveQuads * 4);
 
-              vtx.pos = finalPos;
+  if (liquidsOnly)
+    meshLiquidFaces(volume, outVertices);
+  else
+    meshOpaqueFaces(volume, outVertices);
 
-              float localU = (vtx.uv.x > 0.5f) ? static_cast<float>(w) : 0.0f;
-              float localV = (vtx.uv.y > 0.5f) ? static_cast<float>(h) : 0.0f;
+  size_t quads = outVertices.size() / 4;
+  estimate.estimatedQuads = (estimate.estimatedQuads * 7 + quads) / 8 + 1;
+}
 
-              if (liquidsOnly && dir == 2)
-              {
-                  switch (vIdx)
-                  {
-                      case 0: localU = waterUV.u0; localV = waterUV.v0; break;
-                      case 1: localU = waterUV.u1; localV = waterUV.v1; break;
-                      case 2: localU = waterUV.u2; localV = waterUV.v2; break;
-                      case 3: localU = waterUV.u3; localV = waterUV.v3; break;
-                  }
-              }
-              else if (liquidsOnly && (dir == 0 || dir == 1 || dir == 4 || dir == 5))
-              {
-                localV = isTopVertex ? vertexWaterHeight : 0.0f;
-              }
+// Breadth-first spread of one light channel (0-15 per voxel) through
+// transparent blocks, starting from the queued voxel indices.
+static void spreadLight(const BlockID *blocks, uint8_t *values, bool sky, std::vector<int> &queue)
+{
+  for (size_t head = 0; head < queue.size(); head++)
+  {
+    int idx = queue[head];
+    uint8_t currentLight = values[idx];
+    if (currentLight == 0)
+      continue;
 
-              if (!liquidsOnly)
-              {
-                  switch (rotation)
-                  {
-                    case 1:
-                      {
-                        float tmp = localU;
-                        localU = localV;
-                        localV = static_cast<float>(w) - tmp;
-                      }
-                      break;
-                    case 2:
-                      localV = static_cast<float>(h) - localV;
-                      break;
-                    case 3:
-                      {
-                        float tmp = localU;
-                        localU = static_cast<float>(h) - localV;
-                        localV = tmp;
-                      }
-                      break;
-                    default:
-                      break;
-                  }
-              }
+    int x = idx % CHUNK_SIZE;
+    int y = (idx / CHUNK_SIZE) % CHUNK_SIZE;
+    int z = idx / (CHUNK_SIZE * CHUNK_SIZE);
 
-              vtx.uv = glm::vec2(localU, localV);
-              vtx.tileIndex = static_cast<float>(tileIndex);
-              vtx.skyLight = skyLightNormalized;
-              vtx.faceShade = faceShade;
-              vtx.biomeTint = biomeTint;
+    for (int dir = 0; dir < 6; dir++)
+    {
+      int nx = x + DIRS[dir].x;
+      int ny = y + DIRS[dir].y;
+      int nz = z + DIRS[dir].z;
+      if (nx < 0 || nx >= CHUNK_SIZE ||
+          ny < 0 || ny >= CHUNK_SIZE ||
+          nz < 0 || nz >= CHUNK_SIZE)
+        continue;
 
-              outVertices.push_back(vtx);
-            }
+      int nidx = blockIndex(nx, ny, nz);
+      if (!isBlockTransparent(blocks[nidx]))
+        continue;
 
-            for (int idx = 0; idx < 6; idx++)
-              outIndices.push_back(baseIndex + FACE_INDICES[idx]);
+      uint8_t newLight = passedLight(currentLight, dir, blocks[nidx], ny, sky);
+      if (newLight <= values[nidx])
+        continue;
 
-            for (int dy = 0; dy < h; dy++)
-            {
-              for (int dx = 0; dx < w; dx++)
-              {
-                mask[j + dy][k + dx] = 0;
-                lightMask[j + dy][k + dx] = 0;
-              }
-            }
-          }
-        }
-      }
+      values[nidx] = newLight;
+      queue.push_back(nidx);
     }
   }
+  queue.clear();
 }
 
-void calculateSkyLight(Chunk &c, ChunkManager &chunkManager)
+// Sky light entering the top layer, from incoming (z * CHUNK_SIZE + x) or
+// from open sky; spreadLight carries it down the columns.
+static void castSkyLight(const BlockID *blocks, const uint8_t *incoming, uint8_t *sky, std::vector<int> &queue)
 {
-  auto getBlockWorld = [&](int x, int y, int z) -> BlockID
+  for (int z = 0; z < CHUNK_SIZE; z++)
   {
-    if (x >= 0 && x < CHUNK_SIZE &&
-        y >= 0 && y < CHUNK_SIZE &&
-        z >= 0 && z < CHUNK_SIZE)
+    for (int x = 0; x < CHUNK_SIZE; x++)
     {
-      return c.blocks[blockIndex(x, y, z)];
-    }
-    
-    int neighborCX = c.position.x;
-    int neighborCY = c.position.y;
-    int neighborCZ = c.position.z;
-    int localX = x, localY = y, localZ = z;
-    
-    if (x < 0) { neighborCX--; localX = CHUNK_SIZE + x; }
-    else if (x >= CHUNK_SIZE) { neighborCX++; localX = x - CHUNK_SIZE; }
-    if (y < 0) { neighborCY--; localY = CHUNK_SIZE + y; }
-    else if (y >= CHUNK_SIZE) { neighborCY++; localY = y - CHUNK_SIZE; }
-    if (z < 0) { neighborCZ--; localZ = CHUNK_SIZE + z; }
-    else if (z >= CHUNK_SIZE) { neighborCZ++; localZ = z - CHUNK_SIZE; }
-    
-    Chunk *neighbor = chunkManager.getChunk(neighborCX, neighborCY, neighborCZ);
-    if (!neighbor) return 0;
-    return neighbor->blocks[blockIndex(localX, localY, localZ)];
-  };
-
-  std::fill(std::begin(c.skyLight), std::end(c.skyLight), 0);
+      int idx = blockIndex(x, CHUNK_SIZE - 1, z);
+      if (!isBlockTransparent(blocks[idx]))
+        continue;
 
-  std::queue<glm::ivec3> lightQueue;
+      uint8_t above = incoming ? incoming[z * CHUNK_SIZE + x] : MAX_SKY_LIGHT;
+      sky[idx] = passedLight(above, DIR_NEG_Y, blocks[idx], CHUNK_SIZE - 1, true);
+      if (sky[idx] > 0)
+        queue.push_back(idx);
+    }
+  }
+}
 
-  Chunk *chunkAbove = chunkManager.getChunk(c.position.x, c.position.y + 1, c.position.z);
-  
-  for (int x = 0; x < CHUNK_SIZE; x++)
+static void seedEmitters(const BlockID *blocks, uint8_t *blockLight, std::vector<int> &queue)
+{
+  for (int idx = 0; idx < CHUNK_VOLUME; idx++)
   {
-    for (int z = 0; z < CHUNK_SIZE; z++)
-    {
-      uint8_t incomingLight = MAX_SKY_LIGHT;
-      if (chunkAbove)
-      {
-        BlockID blockAbove = chunkAbove->blocks[blockIndex(x, 0, z)];
-        if (!isBlockTransparent(blockAbove))
-        {
-          incomingLight = chunkAbove->skyLight[blockIndex(x, 0, z)];
-        }
-        else
-        {
-          incomingLight = chunkAbove->skyLight[blockIndex(x, 0, z)];
-        }
-      }
-      
-      uint8_t currentLight = incomingLight;
-      for (int y = CHUNK_SIZE - 1; y >= 0; y--)
-      {
-        int idx = blockIndex(x, y, z);
-        BlockID block = c.blocks[idx];
-        
-        if (block == 0)
-        {
-          c.skyLight[idx] = currentLight;
-          if (currentLight > 1)
-            lightQueue.push({x, y, z});
-        }
-        else if (isBlockTransparent(block))
-        {
-          if (currentLight > 0 && (y % 2 == 0))
-            currentLight = currentLight > 1 ? currentLight - 1 : currentLight;
-          c.skyLight[idx] = currentLight;
-          if (currentLight > 1)
-            lightQueue.push({x, y, z});
-        }
-        else
-        {
-          currentLight = 0;
-          c.skyLight[idx] = 0;
-        }
-      }
-    }
+    uint8_t emission = getBlockLightEmission(blocks[idx]);
+    if (emission == 0)
+      continue;
+    blockLight[idx] = std::min(emission, MAX_BLOCK_LIGHT);
+    queue.push_back(idx);
   }
+}
 
-  while (!lightQueue.empty())
+// Light entering through the faces in neighborMask from the border voxels of
+// the padded volume.
+static void seedFromNeighbors(const PaddedChunkVolume &volume, uint8_t neighborMask, const BlockID *blocks,
+                              bool sky, uint8_t *values, std::vector<int> &queue)
+{
+  for (int dir = 0; dir < 6; dir++)
   {
-    glm::ivec3 pos = lightQueue.front();
-    lightQueue.pop();
-    
-    int idx = blockIndex(pos.x, pos.y, pos.z);
-    uint8_t currentLight = c.skyLight[idx];
-    
-    if (currentLight <= 1) continue;
-    
-    const glm::ivec3 dirs[6] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
-    
-    for (const auto& dir : dirs)
+    if (!(neighborMask & (1u << dir)))
+      continue;
+
+    for (int a = 0; a < CHUNK_SIZE; a++)
     {
-      int nx = pos.x + dir.x;
-      int ny = pos.y + dir.y;
-      int nz = pos.z + dir.z;
-      
-      if (nx < 0 || nx >= CHUNK_SIZE ||
-          ny < 0 || ny >= CHUNK_SIZE ||
-          nz < 0 || nz >= CHUNK_SIZE)
-        continue;
-      
-      int nidx = blockIndex(nx, ny, nz);
-      BlockID neighborBlock = c.blocks[nidx];
-      
-      if (!isBlockTransparent(neighborBlock))
-        continue;
-      
-      uint8_t attenuation = 1;
-      uint8_t newLight = (currentLight > attenuation) ? currentLight - attenuation : 0;
-      
-      if (newLight > c.skyLight[nidx])
+      for (int b = 0; b < CHUNK_SIZE; b++)
       {
-        c.skyLight[nidx] = newLight;
-        if (newLight > 1)
-          lightQueue.push({nx, ny, nz});
+        glm::ivec3 inside = faceVoxel(dir, a, b);
+        glm::ivec3 outside = inside + DIRS[dir];
+        uint8_t border = volume.lightAt(outside.x, outside.y, outside.z);
+        uint8_t level = sky ? skyLightOf(border) : blockLightOf(border);
+        int idx = blockIndex(inside.x, inside.y, inside.z);
+        if (!isBlockTransparent(blocks[idx]))
+          continue;
+
+        uint8_t passed = passedLight(level, oppositeDir(dir), blocks[idx], inside.y, sky);
+        if (passed <= values[idx])
+          continue;
+
+        values[idx] = passed;
+        queue.push_back(idx);
       }
     }
   }
-  
+}
+
+static thread_local std::vector<int> lightQueue;
+
+void computeSectionSkyLight(const BlockID *blocks, const uint8_t *incoming, uint8_t *light)
+{
+  std::fill(light, light + CHUNK_VOLUME, 0);
+  castSkyLight(blocks, incoming, light, lightQueue);
+  spreadLight(blocks, light, true, lightQueue);
+}
+
+void propagateBlockLight(const BlockID *blocks, uint8_t *light)
+{
+  uint8_t blockLight[CHUNK_VOLUME] = {};
+  seedEmitters(blocks, blockLight, lightQueue);
+  spreadLight(blocks, blockLight, false, lightQueue);
+
+  for (int i = 0; i < CHUNK_VOLUME; i++)
+    light[i] = packLight(skyLightOf(light[i]), blockLight[i]);
+}
+
+void computeChunkLight(const PaddedChunkVolume &volume, uint8_t neighborMask, bool openSky, uint8_t *outLight)
+{
+  BlockID blocks[CHUNK_VOLUME];
+  for (int z = 0; z < CHUNK_SIZE; z++)
+    for (int y = 0; y < CHUNK_SIZE; y++)
+      std::copy_n(&volume.blocks[PaddedChunkVolume::index(0, y, z)], CHUNK_SIZE, &blocks[blockIndex(0, y, z)]);
+
+  // A loaded chunk above is seeded like any other face.
+  uint8_t sky[CHUNK_VOLUME] = {};
+  if (openSky)
+    castSkyLight(blocks, nullptr, sky, lightQueue);
+  seedFromNeighbors(volume, neighborMask, blocks, true, sky, lightQueue);
+  spreadLight(blocks, sky, true, lightQueue);
+
+  uint8_t blockLight[CHUNK_VOLUME] = {};
+  seedEmitters(blocks, blockLight, lightQueue);
+  seedFromNeighbors(volume, neighborMask, blocks, false, blockLight, lightQueue);
+  spreadLight(blocks, blockLight, false, lightQueue);
+
+  for (int i = 0; i < CHUNK_VOLUME; i++)
+    outLight[i] = packLight(sky[i], blockLight[i]);
+}
+
+void calculateSkyLight(Chunk &c, ChunkManager &chunkManager)
+{
+  PaddedChunkVolume volume;
+  chunkManager.copyPaddedVolume(c.position.x, c.position.y, c.position.z, volume);
+
+  uint8_t light[CHUNK_VOLUME];
+  computeChunkLight(volume, c.neighborMask, c.position.y == WORLD_HEIGHT_CHUNKS - 1, light);
+  c.light.assign(light);
   c.dirtyLight = false;
 }
 
@@ -612,84 +806,73 @@ void buildChunkMesh(Chunk &c, ChunkManager &chunkManager)
     calculateSkyLight(c, chunkManager);
   }
 
-  auto getBlock = [&](int x, int y, int z) -> BlockID
-  {
-    if (x >= 0 && x < CHUNK_SIZE &&
-        y >= 0 && y < CHUNK_SIZE &&
-        z >= 0 && z < CHUNK_SIZE)
-    {
-      return c.blocks[blockIndex(x, y, z)];
-    }
-    
-    int neighborCX = c.position.x;
-    int neighborCY = c.position.y;
-    int neighborCZ = c.position.z;
-    int localX = x;
-    int localY = y;
-    int localZ = z;
-    
-    if (x < 0) { neighborCX--; localX = CHUNK_SIZE + x; }
-    else if (x >= CHUNK_SIZE) { neighborCX++; localX = x - CHUNK_SIZE; }
-    
-    if (y < 0) { neighborCY--; localY = CHUNK_SIZE + y; }
-    else if (y >= CHUNK_SIZE) { neighborCY++; localY = y - CHUNK_SIZE; }
-    
-    if (z < 0) { neighborCZ--; localZ = CHUNK_SIZE + z; }
-    else if (z >= CHUNK_SIZE) { neighborCZ++; localZ = z - CHUNK_SIZE; }
-    
-    Chunk *neighbor = chunkManager.getChunk(neighborCX, neighborCY, neighborCZ);
-    if (neighbor == nullptr)
-    {
-      return 0;
-    }
-    
-    return neighbor->blocks[blockIndex(localX, localY, localZ)];
-  };
-
-  auto getSkyLight = [&](int x, int y, int z) -> uint8_t
-  {
-    if (x >= 0 && x < CHUNK_SIZE &&
-        y >= 0 && y < CHUNK_SIZE &&
-        z >= 0 && z < CHUNK_SIZE)
-    {
-      return c.skyLight[blockIndex(x, y, z)];
-    }
-    
-    int neighborCX = c.position.x;
-    int neighborCY = c.position.y;
-    int neighborCZ = c.position.z;
-    int localX = x, localY = y, localZ = z;
-    
-    if (x < 0) { neighborCX--; localX = CHUNK_SIZE + x; }
-    else if (x >= CHUNK_SIZE) { neighborCX++; localX = x - CHUNK_SIZE; }
-    if (y < 0) { neighborCY--; localY = CHUNK_SIZE + y; }
-    else if (y >= CHUNK_SIZE) { neighborCY++; localY = y - CHUNK_SIZE; }
-    if (z < 0) { neighborCZ--; localZ = CHUNK_SIZE + z; }
-    else if (z >= CHUNK_SIZE) { neighborCZ++; localZ = z - CHUNK_SIZE; }
-    
-    Chunk *neighbor = chunkManager.getChunk(neighborCX, neighborCY, neighborCZ);
-    if (!neighbor) return MAX_SKY_LIGHT;
-    return neighbor->skyLight[blockIndex(localX, localY, localZ)];
-  };
+  PaddedChunkVolume volume;
+  chunkManager.copyPaddedVolume(c.position.x, c.position.y, c.position.z, volume);
 
   std::vector<Vertex> verts;
-  std::vector<uint32_t> inds;
   std::vector<Vertex> waterVerts;
-  std::vector<uint32_t> waterInds;
   
-  glm::ivec3 chunkWorldOrigin(
-      c.position.x * CHUNK_SIZE,
-      c.position.y * CHUNK_SIZE,
-      c.position.z * CHUNK_SIZE);
-  buildGreedyMesh(c.blocks, chunkWorldOrigin, getBlock, getSkyLight, verts, inds, false);
-  buildGreedyMesh(c.blocks, chunkWorldOrigin, getBlock, getSkyLight, waterVerts, waterInds, true);
+  buildGreedyMesh(volume, verts, false);
+  buildGreedyMesh(volume, waterVerts, true);
   
-  uploadToGPU(c, verts, inds);
-  uploadWaterToGPU(c, waterVerts, waterInds);
+  uploadToGPU(c, verts);
+  uploadWaterToGPU(c, waterVerts);
 }
 
-void uploadToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vector<uint32_t> &inds)
+// Every chunk quad uses the same 0,1,2,0,2,3 pattern, so one index buffer
+// serves all chunk VAOs. It grows in place, keeping VAO bindings valid.
+static GLuint quadIndexBuffer = 0;
+static size_t quadIndexCapacity = 0;
+
+static void bindQuadIndexBuffer(size_t quadCount)
 {
+  if (quadIndexBuffer == 0)
+    glGenBuffers(1, &quadIndexBuffer);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBuffer);
+  if (quadCount <= quadIndexCapacity)
+    return;
+
+  size_t capacity = std::max<size_t>(quadCount, CHUNK_SIZE * CHUNK_SIZE * 6);
+  capacity = std::max(capacity, quadIndexCapacity * 2);
+
+  std::vector<uint32_t> indices(capacity * 6);
+  for (size_t q = 0; q < capacity; q++)
+  {
+    for (int idx = 0; idx < 6; idx++)
+      indices[q * 6 + idx] = static_cast<uint32_t>(q * 4) + FACE_INDICES[idx];
+  }
+
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               indices.size() * sizeof(uint32_t),
+               indices.data(),
+               GL_STATIC_DRAW);
+  quadIndexCapacity = capacity;
+}
+
+void releaseQuadIndexBuffer()
+{
+  if (quadIndexBuffer)
+    glDeleteBuffers(1, &quadIndexBuffer);
+  quadIndexBuffer = 0;
+  quadIndexCapacity = 0;
+}
+
+void uploadToGPU(Chunk &c, const std::vector<Vertex> &verts)
+{
+  if (verts.empty())
+  {
+    c.indexCount = 0;
+    c.vertexCount = 0;
+    return;
+  }
+
+  if (c.vao == 0)
+  {
+    glGenVertexArrays(1, &c.vao);
+    glGenBuffers(1, &c.vbo);
+  }
+
   glBindVertexArray(c.vao);
 
   glBindBuffer(GL_ARRAY_BUFFER, c.vbo);
@@ -698,41 +881,21 @@ void uploadToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vector<u
                verts.data(),
                GL_STATIC_DRAW);
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c.ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               inds.size() * sizeof(uint32_t),
-               inds.data(),
-               GL_STATIC_DRAW);
+  bindQuadIndexBuffer(verts.size() / 4);
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, pos));
+  glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+                         (void *)offsetof(Vertex, positionTileFace));
   glEnableVertexAttribArray(0);
 
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, uv));
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+                         (void *)offsetof(Vertex, uvLightTint));
   glEnableVertexAttribArray(1);
 
-  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, tileIndex));
-  glEnableVertexAttribArray(2);
-
-  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, skyLight));
-  glEnableVertexAttribArray(3);
-
-  glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, faceShade));
-  glEnableVertexAttribArray(4);
-
-  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, biomeTint));
-  glEnableVertexAttribArray(5);
-
-  c.indexCount = static_cast<uint32_t>(inds.size());
+  c.indexCount = static_cast<uint32_t>(verts.size() / 4 * 6);
   c.vertexCount = static_cast<uint32_t>(verts.size());
 }
 
-void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vector<uint32_t> &inds)
+void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts)
 {
   if (verts.empty())
   {
@@ -745,7 +908,6 @@ void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vec
   {
     glGenVertexArrays(1, &c.waterVao);
     glGenBuffers(1, &c.waterVbo);
-    glGenBuffers(1, &c.waterEbo);
   }
 
   glBindVertexArray(c.waterVao);
@@ -756,51 +918,25 @@ void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vec
                verts.data(),
                GL_STATIC_DRAW);
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c.waterEbo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               inds.size() * sizeof(uint32_t),
-               inds.data(),
-               GL_STATIC_DRAW);
+  bindQuadIndexBuffer(verts.size() / 4);
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, pos));
+  glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+                         (void *)offsetof(Vertex, positionTileFace));
   glEnableVertexAttribArray(0);
 
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, uv));
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Vertex),
+                         (void *)offsetof(Vertex, uvLightTint));
   glEnableVertexAttribArray(1);
 
-  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, tileIndex));
-  glEnableVertexAttribArray(2);
-
-  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, skyLight));
-  glEnableVertexAttribArray(3);
-
-  glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, faceShade));
-  glEnableVertexAttribArray(4);
-
-  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                        (void *)offsetof(Vertex, biomeTint));
-  glEnableVertexAttribArray(5);
-
-  c.waterIndexCount = static_cast<uint32_t>(inds.size());
+  c.waterIndexCount = static_cast<uint32_t>(verts.size() / 4 * 6);
   c.waterVertexCount = static_cast<uint32_t>(verts.size());
 }
 
 void buildChunkMeshOffThread(
-    const BlockID* blocks,
-    const uint8_t* skyLight,
-    const glm::ivec3& chunkWorldOrigin,
-    BlockGetter getBlock,
-    LightGetter getSkyLight,
+    const PaddedChunkVolume& volume,
     std::vector<Vertex>& outVertices,
-    std::vector<uint32_t>& outIndices,
-    std::vector<Vertex>& outWaterVertices,
-    std::vector<uint32_t>& outWaterIndices)
+    std::vector<Vertex>& outWaterVertices)
 {
-  buildGreedyMesh(blocks, chunkWorldOrigin, getBlock, getSkyLight, outVertices, outIndices, false);
-  buildGreedyMesh(blocks, chunkWorldOrigin, getBlock, getSkyLight, outWaterVertices, outWaterIndices, true);
+  buildGreedyMesh(volume, outVertices, false);
+  buildGreedyMesh(volume, outWaterVertices, true);
 }
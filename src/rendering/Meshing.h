@@ -1,20 +1,25 @@
 #pragma once
 #include "../world/Chunk.h"
 #include "../world/ChunkManager.h"
+#include <cstdint>
 #include <vector>
-#include <functional>
 #include <glm/glm.hpp>
 
+// Packed chunk vertex, decoded in default.vert and water.vert.
+//   positionTileFace: x:5 z:5 y:11 (1/64 block) tile:8 face:3
+//   uvLightTint:      u:10 v:10 (1/32 texel repeat) light:8 tint:4
+// Light is the packed voxel light byte (sky low nibble, block high). Tint indexes the palette filled
+// by buildTintPalette, with 0 meaning untinted.
 struct Vertex
 {
-  glm::vec3 pos;
-  glm::vec2 uv;
-  float tileIndex;
-  float skyLight;
-  float faceShade;
-  glm::vec3 biomeTint;
+  uint32_t positionTileFace;
+  uint32_t uvLightTint;
 };
 
+constexpr float VERTEX_Y_SCALE = 64.0f;
+constexpr float VERTEX_UV_SCALE = 32.0f;
+constexpr int TINT_PALETTE_SIZE = 16;
+
 enum FaceDir {
   DIR_POS_X = 0,
   DIR_NEG_X = 1,
@@ -33,23 +38,26 @@ constexpr float FACE_SHADE[6] = {
   0.6f    // -Z (North)
 };
 
+// Relights c from scratch on the calling thread; the synchronous path.
 void calculateSkyLight(Chunk &c, ChunkManager &chunkManager);
+// Sky light of one section from the sky light entering each column from above
+// (z * CHUNK_SIZE + x, or null for open sky), spread within the section.
+void computeSectionSkyLight(const BlockID *blocks, const uint8_t *incoming, uint8_t *light);
+void propagateBlockLight(const BlockID *blocks, uint8_t *light);
+// Sky and block light for the interior of volume, also seeded from the border
+// voxels of the faces set in neighborMask. Full sky enters from above only
+// with openSky, i.e. for the top section of the world; below an unloaded
+// section there is none until it loads. The light job kernel.
+void computeChunkLight(const PaddedChunkVolume &volume, uint8_t neighborMask, bool openSky, uint8_t *outLight);
+void buildTintPalette(glm::vec3 (&palette)[TINT_PALETTE_SIZE]);
 
 void buildChunkMesh(Chunk &c, ChunkManager &chunkManager);
-void uploadToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vector<uint32_t> &inds);
-void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts, const std::vector<uint32_t> &inds);
-
-using BlockGetter = std::function<BlockID(int x, int y, int z)>;
-using LightGetter = std::function<uint8_t(int x, int y, int z)>;
+void uploadToGPU(Chunk &c, const std::vector<Vertex> &verts);
+void uploadWaterToGPU(Chunk &c, const std::vector<Vertex> &verts);
+void releaseQuadIndexBuffer();
 
 void buildChunkMeshOffThread(
-    const BlockID* blocks,
-    const uint8_t* skyLight,
-    const glm::ivec3& chunkWorldOrigin,
-    BlockGetter getBlock,
-    LightGetter getSkyLight,
+    const PaddedChunkVolume& volume,
     std::vector<Vertex>& outVertices,
-    std::vector<uint32_t>& outIndices,
-    std::vector<Vertex>& outWaterVertices,
-    std::vector<uint32_t>& outWaterIndices
+    std::vector<Vertex>& outWaterVertices
 );
\ No newline at end of file
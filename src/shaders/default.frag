@@ -4,6 +4,7 @@ out vec4 FragColor;
 in vec2 LocalUV;
 flat in float TileIndex;
 in float SkyLight;
+in float BlockLight;
 in float FaceShade;
 in float FragDepth;
 in vec3 WorldPos;
@@ -26,7 +27,7 @@ void main()
     
     float sunBrightness = timeOfDay;
     float skyLightContribution = SkyLight * sunBrightness;
-    float totalLight = max(skyLightContribution, ambientLight);
+    float totalLight = max(max(skyLightContribution, ambientLight), BlockLight);
     float finalLight = totalLight * FaceShade;
     
     float tintMask = step(0.998, texColor.a);
@@ -37,7 +38,7 @@ void main()
     float fogFactor = 1.0 - exp(-dist * fogDensity);
     fogFactor = clamp(fogFactor, 0.0, 1.0);
     
-    float shadowFogBoost = 1.0 - SkyLight;
+    float shadowFogBoost = 1.0 - max(SkyLight, BlockLight);
     fogFactor = fogFactor + shadowFogBoost * 0.15;
     fogFactor = clamp(fogFactor, 0.0, 0.95);
     
@@ -1,14 +1,11 @@
 #version 460 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aLocalUV;
-layout (location = 2) in float aTileIndex;
-layout (location = 3) in float aSkyLight;
-layout (location = 4) in float aFaceShade;
-layout (location = 5) in vec3 aBiomeTint;
+layout (location = 0) in uint aPositionTileFace;
+layout (location = 1) in uint aUVLightTint;
 
 out vec2 LocalUV;
 flat out float TileIndex;
 out float SkyLight;
+out float BlockLight;
 out float FaceShade;
 out float FragDepth;
 out vec3 WorldPos;
@@ -16,16 +13,26 @@ out vec3 BiomeTint;
 
 uniform mat4 transform;
 uniform mat4 model;
+uniform vec3 tintPalette[16];
+
+// Matches FACE_SHADE in Meshing.h, indexed by face direction.
+const float FACE_SHADE[6] = float[6](0.8, 0.8, 1.0, 0.5, 0.6, 0.6);
 
 void main()
 {
-   vec4 worldPosition = model * vec4(aPos, 1.0);
-   gl_Position = transform * vec4(aPos, 1.0);
-   LocalUV = aLocalUV;
-   TileIndex = aTileIndex;
-   SkyLight = aSkyLight;
-   FaceShade = aFaceShade;
+   vec3 pos = vec3(float(aPositionTileFace & 31u),
+                   float((aPositionTileFace >> 10) & 2047u) / 64.0,
+                   float((aPositionTileFace >> 5) & 31u));
+   uint face = aPositionTileFace >> 29;
+
+   vec4 worldPosition = model * vec4(pos, 1.0);
+   gl_Position = transform * vec4(pos, 1.0);
+   LocalUV = vec2(float(aUVLightTint & 1023u), float((aUVLightTint >> 10) & 1023u)) / 32.0;
+   TileIndex = float((aPositionTileFace >> 21) & 255u);
+   SkyLight = float((aUVLightTint >> 20) & 15u) / 15.0;
+   BlockLight = float((aUVLightTint >> 24) & 15u) / 15.0;
+   FaceShade = FACE_SHADE[face];
    FragDepth = gl_Position.z;
    WorldPos = worldPosition.xyz;
-   BiomeTint = aBiomeTint;
+   BiomeTint = tintPalette[aUVLightTint >> 28];
 }
@@ -4,6 +4,7 @@ out vec4 FragColor;
 in vec2 LocalUV;
 flat in float TileIndex;
 in float SkyLight;
+in float BlockLight;
 in float FaceShade;
 in vec3 WorldPos;
 
@@ -18,7 +19,7 @@ uniform float time;
 void main()
 {
     float sunBrightness = timeOfDay;
-    float totalLight = max(SkyLight * sunBrightness, ambientLight);
+    float totalLight = max(max(SkyLight * sunBrightness, ambientLight), BlockLight);
 
     vec2 flowUV = LocalUV;
     bool isFlowing = abs(flowUV.x - 0.5) > 0.01 || abs(flowUV.y - 0.5) > 0.01;
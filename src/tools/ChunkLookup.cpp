@@ -0,0 +1,108 @@
+// Times random and 3x3x3 neighbourhood chunk lookups through ChunkGrid against
+// the unordered_map ChunkManager used before, and checks both agree.
+// Built with -DVOXEL_BUILD_TOOLS=ON. Usage: ChunkLookup [radius] [lookups]
+#include "../world/ChunkGrid.h"
+#include "../world/ChunkManager.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+using ChunkCoord = ChunkManager::ChunkCoord;
+using ChunkMap = ChunkManager::ChunkMap;
+
+template <typename F>
+double timeNs(size_t count, F&& f)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int radius = argc > 1 ? std::atoi(argv[1]) : 12;
+  size_t lookups = argc > 2 ? static_cast<size_t>(std::atoll(argv[2])) : 8000000;
+
+  // Loaded chunks fill the streaming square; the grid is sized the way
+  // ChunkManager::rebuildGrid sizes it.
+  ChunkMap map;
+  ChunkGrid grid;
+  grid.resize(2 * radius + 3, WORLD_HEIGHT_CHUNKS);
+  for (int cz = -radius; cz <= radius; cz++)
+  {
+    for (int cx = -radius; cx <= radius; cx++)
+    {
+      for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+      {
+        ChunkCoord coord(cx, cy, cz);
+        auto chunk = std::make_unique<Chunk>();
+        chunk->position = coord;
+        grid.insert(chunk.get());
+        map.emplace(coord, std::move(chunk));
+      }
+    }
+  }
+
+  // Queries cover the loaded square plus a ring of unloaded columns, so
+  // misses are part of the mix as they are at the streaming edge.
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> horizontal(-radius - 2, radius + 2);
+  std::uniform_int_distribution<int> vertical(0, WORLD_HEIGHT_CHUNKS - 1);
+  std::vector<ChunkCoord> queries(lookups);
+  for (ChunkCoord& q : queries)
+    q = ChunkCoord(horizontal(rng), vertical(rng), horizontal(rng));
+
+  for (const ChunkCoord& q : queries)
+  {
+    auto it = map.find(q);
+    Chunk* expected = it != map.end() ? it->second.get() : nullptr;
+    if (grid.find(q) != expected)
+    {
+      std::cerr << "grid and map disagree at (" << q.x << ", " << q.y << ", " << q.z << ")" << std::endl;
+      return 1;
+    }
+  }
+  std::cout << map.size() << " chunks loaded, grid agrees with the map on " << lookups << " queries" << std::endl;
+
+  size_t hits = 0;
+  double mapRandom = timeNs(lookups, [&]
+  {
+    for (const ChunkCoord& q : queries)
+      hits += map.find(q) != map.end();
+  });
+  double gridRandom = timeNs(lookups, [&]
+  {
+    for (const ChunkCoord& q : queries)
+      hits += grid.find(q) != nullptr;
+  });
+
+  size_t centers = lookups / 27;
+  double mapNeighbors = timeNs(centers * 27, [&]
+  {
+    for (size_t i = 0; i < centers; i++)
+      for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+          for (int dx = -1; dx <= 1; dx++)
+            hits += map.find(queries[i] + ChunkCoord(dx, dy, dz)) != map.end();
+  });
+  double gridNeighbors = timeNs(centers * 27, [&]
+  {
+    for (size_t i = 0; i < centers; i++)
+      for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+          for (int dx = -1; dx <= 1; dx++)
+            hits += grid.find(queries[i] + ChunkCoord(dx, dy, dz)) != nullptr;
+  });
+
+  std::cout << "random:        map " << mapRandom << " ns, grid " << gridRandom << " ns" << std::endl;
+  std::cout << "neighbourhood: map " << mapNeighbors << " ns, grid " << gridNeighbors << " ns" << std::endl;
+  std::cout << "(" << hits << " hits)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Compares the biome, amplitude and height fields generation interpolates from
+// the coarse climate lattice with the exact per-block evaluation it replaced,
+// and times computeColumnTerrain in both modes.
+// Built with -DVOXEL_BUILD_TOOLS=ON; exits non-zero past the tolerances below.
+// Usage: ClimateLattice [columns]
+#include "../world/TerrainGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Interpolation only moves biome edges by a block or two, so a small share of
+// blocks change biome; amplitude is a blend of biome constants and stays close.
+constexpr double MAX_BIOME_MISMATCH = 0.001;
+constexpr float MAX_AMPLITUDE_ERROR = 0.15f;
+constexpr double MAX_MEAN_HEIGHT_ERROR = 0.05;
+
+struct Column
+{
+  int cx, cz;
+};
+
+struct Fields
+{
+  ColumnMaps maps;
+  float amplitudes[CHUNK_SIZE * CHUNK_SIZE];
+};
+
+void sampleFields(const Column& column, Fields& out)
+{
+  clearColumnMaps();
+  out.maps = *getColumnMaps(column.cx, column.cz);
+  for (int z = 0; z < CHUNK_SIZE; z++)
+    for (int x = 0; x < CHUNK_SIZE; x++)
+      out.amplitudes[z * CHUNK_SIZE + x] =
+          getTerrainAmplitudeAt(column.cx * CHUNK_SIZE + x, column.cz * CHUNK_SIZE + z);
+}
+
+// Seconds per computeColumnTerrain call, with the cache cleared so every call
+// computes its column maps.
+double timeColumns(const std::vector<Column>& columns, size_t& sink)
+{
+  clearColumnMaps();
+  ColumnTerrain terrain;
+  auto start = std::chrono::steady_clock::now();
+  for (const Column& column : columns)
+  {
+    computeColumnTerrain(column.cx, column.cz, terrain);
+    sink += terrain.treeCount;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  clearColumnMaps();
+  return seconds / columns.size();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int columnCount = argc > 1 ? std::atoi(argv[1]) : 400;
+
+  // Spread far enough to cross every biome.
+  std::mt19937 rng(77);
+  std::uniform_int_distribution<int> coord(-4000, 4000);
+  std::vector<Column> columns(columnCount);
+  for (Column& column : columns)
+    column = Column{coord(rng), coord(rng)};
+
+  Fields exact;
+  Fields lattice;
+  size_t blocks = 0;
+  size_t biomeMismatches = 0;
+  float maxAmplitudeError = 0.0f;
+  int maxHeightError = 0;
+  double heightErrorSum = 0.0;
+  for (const Column& column : columns)
+  {
+    setExactClimateSampling(true);
+    sampleFields(column, exact);
+    setExactClimateSampling(false);
+    sampleFields(column, lattice);
+
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+    {
+      int heightError = std::abs(exact.maps.heights[i] - lattice.maps.heights[i]);
+      biomeMismatches += exact.maps.biomes[i] != lattice.maps.biomes[i];
+      maxAmplitudeError = std::max(maxAmplitudeError, std::fabs(exact.amplitudes[i] - lattice.amplitudes[i]));
+      maxHeightError = std::max(maxHeightError, heightError);
+      heightErrorSum += heightError;
+      blocks++;
+    }
+  }
+
+  double biomeMismatch = static_cast<double>(biomeMismatches) / blocks;
+  double meanHeightError = heightErrorSum / blocks;
+  std::cout << blocks << " blocks in " << columnCount << " columns" << std::endl;
+  std::cout << "biome mismatch:  " << biomeMismatch * 100.0 << "% (limit " << MAX_BIOME_MISMATCH * 100.0 << "%)" << std::endl;
+  std::cout << "amplitude error: max " << maxAmplitudeError << " (limit " << MAX_AMPLITUDE_ERROR << ")" << std::endl;
+  std::cout << "height error:    mean " << meanHeightError << " (limit " << MAX_MEAN_HEIGHT_ERROR
+            << "), max " << maxHeightError << std::endl;
+
+  size_t trees = 0;
+  setExactClimateSampling(true);
+  double exactSeconds = timeColumns(columns, trees);
+  setExactClimateSampling(false);
+  double latticeSeconds = timeColumns(columns, trees);
+  std::cout << "computeColumnTerrain: per-block " << exactSeconds * 1e6 << " us, lattice "
+            << latticeSeconds * 1e6 << " us, " << exactSeconds / latticeSeconds << "x (" << trees << " trees)" << std::endl;
+
+  if (biomeMismatch > MAX_BIOME_MISMATCH || maxAmplitudeError > MAX_AMPLITUDE_ERROR ||
+      meanHeightError > MAX_MEAN_HEIGHT_ERROR)
+  {
+    std::cerr << "lattice exceeds tolerance" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Runs a fixed set of generate, light and mesh jobs through JobSystem with 1
+// to N workers and prints the throughput of each count.
+// Built with -DVOXEL_BUILD_TOOLS=ON. Usage: JobThroughput [maxWorkers] [columns]
+#include "../utils/JobSystem.h"
+#include "../utils/BlockTypes.h"
+#include "../world/TerrainGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The padded volume every light and mesh job starts from: generated terrain
+// around the surface, so both kernels do representative work.
+void fillVolume(PaddedChunkVolume& volume)
+{
+  static BlockID blocks[CHUNK_VOLUME];
+  std::fill(blocks, blocks + CHUNK_VOLUME, 0);
+  generateTerrain(blocks, 0, 4, 0);
+  for (int z = -1; z <= CHUNK_SIZE; z++)
+    for (int y = -1; y <= CHUNK_SIZE; y++)
+      for (int x = -1; x <= CHUNK_SIZE; x++)
+      {
+        int sx = (x + CHUNK_SIZE) % CHUNK_SIZE;
+        int sy = (y + CHUNK_SIZE) % CHUNK_SIZE;
+        int sz = (z + CHUNK_SIZE) % CHUNK_SIZE;
+        volume.blocks[PaddedChunkVolume::index(x, y, z)] = blocks[blockIndex(sx, sy, sz)];
+        volume.light[PaddedChunkVolume::index(x, y, z)] = 0;
+      }
+  std::fill(std::begin(volume.biomes), std::end(volume.biomes), BiomeID::Plains);
+}
+
+// Submits the whole job set, waits for every completion and returns the
+// elapsed seconds. Column maps are cleared first so each run pays for them.
+double runJobs(int workers, int columns, const PaddedChunkVolume& volume)
+{
+  clearColumnMaps();
+  JobSystem jobSystem;
+  jobSystem.start(workers);
+
+  // Built up front so the timing covers submission and execution only.
+  std::vector<std::unique_ptr<Job>> jobs;
+  for (int i = 0; i < columns; i++)
+  {
+    auto generate = std::make_unique<GenerateColumnJob>();
+    generate->cx = i % 16;
+    generate->cz = i / 16;
+    generate->sections = (1u << WORLD_HEIGHT_CHUNKS) - 1;
+    jobs.push_back(std::move(generate));
+
+    for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+    {
+      auto light = std::make_unique<LightChunkJob>();
+      light->cx = i % 16;
+      light->cy = cy;
+      light->cz = i / 16;
+      light->volume = volume;
+      light->neighborMask = 0x3F;
+      jobs.push_back(std::move(light));
+
+      auto mesh = std::make_unique<MeshChunkJob>();
+      mesh->cx = i % 16;
+      mesh->cy = cy;
+      mesh->cz = i / 16;
+      mesh->volume = volume;
+      jobs.push_back(std::move(mesh));
+    }
+  }
+
+  size_t submitted = jobs.size();
+  auto start = std::chrono::steady_clock::now();
+  for (std::unique_ptr<Job>& job : jobs)
+    jobSystem.enqueue(std::move(job));
+
+  std::vector<std::unique_ptr<GenerateColumnJob>> generated;
+  std::vector<std::unique_ptr<LightChunkJob>> lit;
+  std::vector<std::unique_ptr<MeshChunkJob>> meshed;
+  while (jobSystem.completedJobCount() < submitted)
+    std::this_thread::yield();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  jobSystem.pollCompletedGenerations(generated);
+  jobSystem.pollCompletedLights(lit);
+  jobSystem.pollCompletedMeshes(meshed);
+  jobSystem.stop();
+  return seconds;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int hardware = static_cast<int>(std::thread::hardware_concurrency());
+  int maxWorkers = argc > 1 ? std::atoi(argv[1]) : (std::max)(1, hardware);
+  int columns = argc > 2 ? std::atoi(argv[2]) : 64;
+
+  initBlockTypes();
+  auto volume = std::make_unique<PaddedChunkVolume>();
+  fillVolume(*volume);
+
+  size_t jobs = static_cast<size_t>(columns) * (1 + 2 * WORLD_HEIGHT_CHUNKS);
+  std::cout << jobs << " jobs (" << columns << " generate columns, "
+            << columns * WORLD_HEIGHT_CHUNKS << " light, " << columns * WORLD_HEIGHT_CHUNKS << " mesh)" << std::endl;
+
+  double base = 0.0;
+  for (int workers = 1; workers <= maxWorkers; workers++)
+  {
+    double seconds = runJobs(workers, columns, *volume);
+    double rate = jobs / seconds;
+    if (workers == 1)
+      base = rate;
+    std::cout << workers << " workers: " << rate << " jobs/sec, " << rate / base << "x" << std::endl;
+  }
+  return 0;
+}
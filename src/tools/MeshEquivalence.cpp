@@ -0,0 +1,320 @@
+// Checks the bitmask opaque mesher against the per-voxel greedy mesher it
+// replaced, on random volumes and on generated terrain, and times both.
+// Built with -DVOXEL_BUILD_TOOLS=ON; exits non-zero on the first mismatch.
+#include "../rendering/Meshing.h"
+#include "../utils/BlockTypes.h"
+#include "../world/Chunk.h"
+#include "../world/TerrainGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// One merged face: what both meshers agree on independent of vertex layout.
+struct Quad
+{
+  int dir;
+  int tile;
+  uint8_t light;
+  uint32_t minX, minY, minZ;
+  uint32_t maxX, maxY, maxZ;
+
+  bool operator==(const Quad& o) const
+  {
+    return dir == o.dir && tile == o.tile && light == o.light &&
+           minX == o.minX && minY == o.minY && minZ == o.minZ &&
+           maxX == o.maxX && maxY == o.maxY && maxZ == o.maxZ;
+  }
+};
+
+// The greedy mesher as it was before column bitmasks: every voxel is visited
+// once per direction, a slice mask is filled and merged row by row.
+void referenceOpaqueQuads(const PaddedChunkVolume& volume, std::vector<Quad>& out)
+{
+  out.clear();
+  for (int dir = 0; dir < 6; dir++)
+  {
+    glm::ivec3 n = DIRS[dir];
+    int axis = 0;
+    if (n.y != 0) axis = 1;
+    if (n.z != 0) axis = 2;
+
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+
+    BlockID mask[CHUNK_SIZE][CHUNK_SIZE];
+    uint8_t lightMask[CHUNK_SIZE][CHUNK_SIZE];
+
+    for (int i = 0; i < CHUNK_SIZE; i++)
+    {
+      for (int j = 0; j < CHUNK_SIZE; j++)
+      {
+        for (int k = 0; k < CHUNK_SIZE; k++)
+        {
+          glm::ivec3 pos;
+          pos[axis] = i;
+          pos[u] = k;
+          pos[v] = j;
+
+          BlockID current = volume.blockAt(pos.x, pos.y, pos.z);
+          glm::ivec3 npos = pos + n;
+          BlockID neighbor = volume.blockAt(npos.x, npos.y, npos.z);
+
+          bool showFace = false;
+          if (current != 0 && !g_blockTypes[current].isLiquid)
+          {
+            if (neighbor == 0 || g_blockTypes[neighbor].isLiquid)
+              showFace = true;
+            else if (isBlockTransparent(neighbor))
+              showFace = current != neighbor;
+          }
+
+          mask[j][k] = showFace ? current : 0;
+          lightMask[j][k] = showFace ? volume.lightAt(npos.x, npos.y, npos.z) : 0;
+        }
+      }
+
+      for (int j = 0; j < CHUNK_SIZE; j++)
+      {
+        for (int k = 0; k < CHUNK_SIZE; k++)
+        {
+          if (mask[j][k] == 0)
+            continue;
+
+          BlockID type = mask[j][k];
+          uint8_t light = lightMask[j][k];
+          int w = 1;
+          int h = 1;
+
+          while (k + w < CHUNK_SIZE && mask[j][k + w] == type && lightMask[j][k + w] == light)
+            w++;
+
+          bool done = false;
+          while (j + h < CHUNK_SIZE)
+          {
+            for (int dx = 0; dx < w; dx++)
+            {
+              if (mask[j + h][k + dx] != type || lightMask[j + h][k + dx] != light)
+              {
+                done = true;
+                break;
+              }
+            }
+            if (done) break;
+            h++;
+          }
+
+          glm::ivec3 lo(0);
+          glm::ivec3 hi(0);
+          lo[axis] = hi[axis] = i + (n[axis] > 0 ? 1 : 0);
+          lo[u] = k;
+          hi[u] = k + w;
+          lo[v] = j;
+          hi[v] = j + h;
+
+          Quad q;
+          q.dir = dir;
+          q.tile = g_blockTypes[type].faceTexture[dir] & 255;
+          q.light = light;
+          q.minX = lo.x;
+          q.minY = lo.y * static_cast<uint32_t>(VERTEX_Y_SCALE);
+          q.minZ = lo.z;
+          q.maxX = hi.x;
+          q.maxY = hi.y * static_cast<uint32_t>(VERTEX_Y_SCALE);
+          q.maxZ = hi.z;
+          out.push_back(q);
+
+          for (int dy = 0; dy < h; dy++)
+          {
+            for (int dx = 0; dx < w; dx++)
+            {
+              mask[j + dy][k + dx] = 0;
+              lightMask[j + dy][k + dx] = 0;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Reads quads back out of packed vertices, four per quad.
+void decodeQuads(const std::vector<Vertex>& vertices, std::vector<Quad>& out)
+{
+  out.clear();
+  for (size_t q = 0; q + 4 <= vertices.size(); q += 4)
+  {
+    Quad quad;
+    quad.dir = static_cast<int>(vertices[q].positionTileFace >> 29);
+    quad.tile = static_cast<int>((vertices[q].positionTileFace >> 21) & 255u);
+    quad.light = static_cast<uint8_t>((vertices[q].uvLightTint >> 20) & 255u);
+    quad.minX = quad.minY = quad.minZ = UINT32_MAX;
+    quad.maxX = quad.maxY = quad.maxZ = 0;
+    for (size_t c = q; c < q + 4; c++)
+    {
+      uint32_t p = vertices[c].positionTileFace;
+      uint32_t x = p & 31u;
+      uint32_t z = (p >> 5) & 31u;
+      uint32_t y = (p >> 10) & 2047u;
+      quad.minX = std::min(quad.minX, x);
+      quad.minY = std::min(quad.minY, y);
+      quad.minZ = std::min(quad.minZ, z);
+      quad.maxX = std::max(quad.maxX, x);
+      quad.maxY = std::max(quad.maxY, y);
+      quad.maxZ = std::max(quad.maxZ, z);
+    }
+    out.push_back(quad);
+  }
+}
+
+// Air-heavy noise over every defined block, liquids included, with a few
+// light levels so merging is exercised across light boundaries.
+void fillRandomVolume(PaddedChunkVolume& volume, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> block(0, g_blockTypeCount * 2 - 1);
+  std::uniform_int_distribution<int> light(0, 3);
+  for (int i = 0; i < PADDED_CHUNK_VOLUME; i++)
+  {
+    int b = block(rng);
+    volume.blocks[i] = static_cast<BlockID>(b < g_blockTypeCount ? b : 0);
+    volume.light[i] = static_cast<uint8_t>(light(rng) * 5);
+  }
+  std::memset(volume.biomes, 0, sizeof(volume.biomes));
+}
+
+// A generated section with its 26 neighbours, each lit as if under open sky.
+void fillGeneratedVolume(PaddedChunkVolume& volume, int cx, int cy, int cz)
+{
+  static BlockID blocks[CHUNK_VOLUME];
+  static uint8_t light[CHUNK_VOLUME];
+  for (int dz = -1; dz <= 1; dz++)
+  {
+    for (int dy = -1; dy <= 1; dy++)
+    {
+      for (int dx = -1; dx <= 1; dx++)
+      {
+        std::memset(blocks, 0, sizeof(blocks));
+        if (cy + dy >= 0 && cy + dy < WORLD_HEIGHT_CHUNKS)
+          generateTerrain(blocks, cx + dx, cy + dy, cz + dz);
+        computeSectionSkyLight(blocks, nullptr, light);
+        propagateBlockLight(blocks, light);
+
+        for (int z = -1; z <= CHUNK_SIZE; z++)
+        {
+          for (int y = -1; y <= CHUNK_SIZE; y++)
+          {
+            for (int x = -1; x <= CHUNK_SIZE; x++)
+            {
+              int sx = x - dx * CHUNK_SIZE;
+              int sy = y - dy * CHUNK_SIZE;
+              int sz = z - dz * CHUNK_SIZE;
+              if (sx < 0 || sx >= CHUNK_SIZE || sy < 0 || sy >= CHUNK_SIZE || sz < 0 || sz >= CHUNK_SIZE)
+                continue;
+              int idx = blockIndex(sx, sy, sz);
+              volume.blocks[PaddedChunkVolume::index(x, y, z)] = blocks[idx];
+              volume.light[PaddedChunkVolume::index(x, y, z)] = light[idx];
+            }
+          }
+        }
+      }
+    }
+  }
+  std::memset(volume.biomes, 0, sizeof(volume.biomes));
+}
+
+bool compareVolume(const PaddedChunkVolume& volume, const char* label, int index)
+{
+  std::vector<Vertex> vertices;
+  std::vector<Vertex> waterVertices;
+  std::vector<Quad> expected;
+  std::vector<Quad> actual;
+
+  buildChunkMeshOffThread(volume, vertices, waterVertices);
+  referenceOpaqueQuads(volume, expected);
+  decodeQuads(vertices, actual);
+
+  if (expected == actual)
+    return true;
+
+  size_t first = 0;
+  while (first < expected.size() && first < actual.size() && expected[first] == actual[first])
+    first++;
+  std::cerr << label << " volume " << index << ": " << expected.size() << " reference quads, "
+            << actual.size() << " bitmask quads, first difference at quad " << first << std::endl;
+  return false;
+}
+
+template <typename F>
+double timeMs(F&& f)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int randomCount = argc > 1 ? std::atoi(argv[1]) : 300;
+  int generatedRadius = argc > 2 ? std::atoi(argv[2]) : 4;
+
+  initBlockTypes();
+  std::mt19937 rng(1234);
+
+  std::vector<PaddedChunkVolume> volumes(1);
+  for (int i = 0; i < randomCount; i++)
+  {
+    fillRandomVolume(volumes[0], rng);
+    if (!compareVolume(volumes[0], "random", i))
+      return 1;
+  }
+  std::cout << randomCount << " random volumes match" << std::endl;
+
+  volumes.clear();
+  for (int cz = -generatedRadius; cz < generatedRadius; cz++)
+  {
+    for (int cx = -generatedRadius; cx < generatedRadius; cx++)
+    {
+      for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+      {
+        volumes.emplace_back();
+        fillGeneratedVolume(volumes.back(), cx, cy, cz);
+        if (!compareVolume(volumes.back(), "generated", static_cast<int>(volumes.size() - 1)))
+          return 1;
+      }
+    }
+  }
+  std::cout << volumes.size() << " generated volumes match" << std::endl;
+
+  std::vector<Vertex> vertices;
+  std::vector<Vertex> waterVertices;
+  std::vector<Quad> quads;
+  size_t sink = 0;
+  double referenceMs = timeMs([&]
+  {
+    for (const PaddedChunkVolume& volume : volumes)
+    {
+      referenceOpaqueQuads(volume, quads);
+      sink += quads.size();
+    }
+  });
+  double bitmaskMs = timeMs([&]
+  {
+    for (const PaddedChunkVolume& volume : volumes)
+    {
+      buildChunkMeshOffThread(volume, vertices, waterVertices);
+      sink += vertices.size();
+    }
+  });
+
+  std::cout << "generated volumes: reference " << referenceMs << " ms, bitmask " << bitmaskMs
+            << " ms (bitmask includes vertex packing and the liquid pass; " << sink << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Runs the SSE2 and scalar gradient blends on the same batched inputs, checks
+// both against the per-point Perlin3D and siv::PerlinNoise evaluators, and
+// times section generation on one core with each.
+// Built with -DVOXEL_BUILD_TOOLS=ON; exits non-zero past the error limits below.
+// Usage: NoiseKernels [points] [columns]
+#include "../thirdparty/PerlinNoise.hpp"
+#include "../world/CaveGenerator.h"
+#include "../world/NoiseBatch.h"
+#include "../world/Perlin3D.h"
+#include "../world/TerrainGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Perlin3D is float throughout, so the batch should differ only by operation
+// order. siv::PerlinNoise blends in double and the batch in float.
+constexpr float MAX_PERLIN3D_ERROR = 1e-5f;
+constexpr float MAX_OCTAVE2D_ERROR = 1e-5f;
+
+struct Points
+{
+  std::vector<float> x, y, z;
+};
+
+// Maximum error of Perlin3D::noiseBatch and fbmBatch against noise and fbm, at
+// the cave frequencies.
+float perlin3DError(const Perlin3D& noise, const Points& points, std::vector<float>& out)
+{
+  const CaveConfig cfg;
+  int count = static_cast<int>(points.x.size());
+  float maxError = 0.0f;
+
+  for (float freq : {cfg.spaghettiFrequency, cfg.vegFrequency, 0.1f})
+  {
+    noise.noiseBatch(points.x.data(), points.y.data(), points.z.data(), count, freq, out.data());
+    for (int i = 0; i < count; i++)
+    {
+      float expected = noise.noise(points.x[i] * freq, points.y[i] * freq, points.z[i] * freq);
+      maxError = std::max(maxError, std::fabs(out[i] - expected));
+    }
+  }
+
+  noise.fbmBatch(points.x.data(), points.y.data(), points.z.data(), count,
+                 cfg.cheeseOctaves, cfg.cheeseGain, cfg.cheeseFrequency, out.data());
+  for (int i = 0; i < count; i++)
+  {
+    float expected = noise.fbm(points.x[i], points.y[i], points.z[i],
+                               cfg.cheeseOctaves, cfg.cheeseGain, cfg.cheeseFrequency);
+    maxError = std::max(maxError, std::fabs(out[i] - expected));
+  }
+  return maxError;
+}
+
+// Maximum error of octave2D01Batch against octave2D_01, with the settings the
+// terrain height and climate fields use.
+float octave2DError(const siv::PerlinNoise& noise, const Points& points, std::vector<float>& out)
+{
+  struct Settings
+  {
+    double frequency;
+    int octaves;
+    double persistence;
+  };
+  const Settings settings[] = {{0.0015, 3, 0.5}, {0.002, 2, 0.5}, {0.01, 4, 0.45}, {0.05, 2, 0.5}};
+
+  int count = static_cast<int>(points.x.size());
+  float maxError = 0.0f;
+  for (const Settings& s : settings)
+  {
+    octave2D01Batch(noise, points.x.data(), points.z.data(), count, s.frequency, s.octaves, s.persistence, out.data());
+    for (int i = 0; i < count; i++)
+    {
+      double expected = noise.octave2D_01(points.x[i] * s.frequency, points.z[i] * s.frequency,
+                                          s.octaves, s.persistence);
+      maxError = std::max(maxError, static_cast<float>(std::fabs(out[i] - expected)));
+    }
+  }
+  return maxError;
+}
+
+// Sections per second generated the way GenerateColumnJob does it, on this
+// thread alone. Column maps are cleared first so their noise is included.
+double sectionsPerSecond(int columns, size_t& sink)
+{
+  clearColumnMaps();
+  static BlockID blocks[CHUNK_VOLUME];
+  ColumnTerrain terrain;
+  size_t sections = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < columns; i++)
+  {
+    int cx = i % 16;
+    int cz = i / 16;
+    computeColumnTerrain(cx, cz, terrain);
+    for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+    {
+      BlockID uniform;
+      if (!uniformSection(terrain, cy, uniform))
+      {
+        std::fill(blocks, blocks + CHUNK_VOLUME, 0);
+        generateTerrain(blocks, terrain, cy);
+        applyCavesToBlocks(blocks, glm::ivec3(cx, cy, cz), DEFAULT_WORLD_SEED, terrain.maps->heights);
+        sink += blocks[0];
+      }
+      sections++;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  clearColumnMaps();
+  return sections / seconds;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  int pointCount = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int columns = argc > 2 ? std::atoi(argv[2]) : 64;
+
+  // World-scale coordinates, negative ones included, with fractional parts so
+  // cell offsets cover the whole [0, 1) range.
+  std::mt19937 rng(2024);
+  std::uniform_real_distribution<float> horizontal(-20000.0f, 20000.0f);
+  std::uniform_real_distribution<float> vertical(0.0f, static_cast<float>(WORLD_HEIGHT_CHUNKS * CHUNK_SIZE));
+  Points points;
+  for (int i = 0; i < pointCount; i++)
+  {
+    points.x.push_back(horizontal(rng));
+    points.y.push_back(vertical(rng));
+    points.z.push_back(horizontal(rng));
+  }
+
+  Perlin3D perlin3D(DEFAULT_WORLD_SEED);
+  siv::PerlinNoise perlin2D{6767420};
+  std::vector<float> out(pointCount);
+
+  struct Kernel
+  {
+    const char* name;
+    bool scalar;
+  };
+  std::vector<Kernel> kernels;
+  if (simdNoiseBlendAvailable())
+    kernels.push_back({"sse2", false});
+  else
+    std::cout << "no SIMD blend on this target, checking the scalar kernel only" << std::endl;
+  kernels.push_back({"scalar", true});
+
+  bool failed = false;
+  size_t sink = 0;
+  for (const Kernel& kernel : kernels)
+  {
+    setScalarNoiseBlend(kernel.scalar);
+    float error3D = perlin3DError(perlin3D, points, out);
+    float error2D = octave2DError(perlin2D, points, out);
+    double rate = sectionsPerSecond(columns, sink);
+    std::cout << kernel.name << ": Perlin3D max error " << error3D << " (limit " << MAX_PERLIN3D_ERROR
+              << "), octave2D_01 max error " << error2D << " (limit " << MAX_OCTAVE2D_ERROR
+              << "), " << rate << " chunks/sec per core" << std::endl;
+    failed |= error3D > MAX_PERLIN3D_ERROR || error2D > MAX_OCTAVE2D_ERROR;
+  }
+  setScalarNoiseBlend(false);
+  std::cout << "(" << sink << ")" << std::endl;
+
+  if (failed)
+  {
+    std::cerr << "batched noise exceeds the error limit" << std::endl;
+    return 1;
+  }
+  return 0;
+}
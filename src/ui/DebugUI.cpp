@@ -99,8 +99,25 @@ void drawDebugUI(
             ImGui::Separator();
             ImGui::Text("Chunks loaded: %zu", chunkManager->chunks.size());
             ImGui::Text("Chunks loading: %zu", chunkManager->loadingChunks.size());
+            ImGui::Text("Chunks lighting: %zu", chunkManager->lightingChunks.size());
             ImGui::Text("Chunks meshing: %zu", chunkManager->meshingChunks.size());
-            ImGui::Text("Jobs pending: %zu", jobSystem->pendingJobCount());
+            ImGui::Text("Load backlog: %zu  mesh queue: %zu", chunkManager->streamingBacklog(), chunkManager->meshQueueSize());
+            ChunkManager::ContentCounts content = chunkManager->countChunkContent();
+            ImGui::Text("Chunks empty: %zu  buried: %zu  solid: %zu  mixed: %zu",
+                        content.empty, content.buried, content.exposed, content.mixed);
+            ImGui::Text("Chunk memory: %.1f MB", chunkManager->chunkMemoryUsage() / (1024.0 * 1024.0));
+            ImGui::Text("Cached column maps: %zu", columnMapsCount());
+            ImGui::Text("Jobs pending: %zu  queued: %zu", jobSystem->pendingJobCount(), chunkManager->pendingJobs.size());
+            ImGui::Text("Jobs cancelled: %zu  stale: %zu", chunkManager->cancelledJobs, chunkManager->staleJobs);
+            // Heap allocations in the chunk pipeline: job objects missing the
+            // pools, mesh output growing past a pooled job's capacity, and
+            // column maps. All three stop climbing once streaming settles.
+            ImGui::Text("Pipeline allocs  jobs: %zu  mesh buffers: %llu  column maps: %zu",
+                        chunkManager->jobAllocationCount(),
+                        static_cast<unsigned long long>(jobSystem->meshBufferGrowthCount()),
+                        columnMapsAllocationCount());
+            ImGui::Text("Jobs pooled: %zu", chunkManager->pooledJobCount());
+
             ImGui::Text("Frustum solid  tested:%d  culled:%d  drawn:%d", frustumSolidTested, frustumSolidCulled, frustumSolidDrawn);
             ImGui::Text("Frustum water  tested:%d  culled:%d  drawn:%d", frustumWaterTested, frustumWaterCulled, frustumWaterDrawn);
 
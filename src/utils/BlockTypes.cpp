@@ -2,6 +2,7 @@
 
 std::array<BlockType, 256> g_blockTypes;
 std::array<BlockType, 256> g_defaultBlockTypes;
+int g_blockTypeCount = 0;
 
 static void setAllFaces(BlockType& b, int tex)
 {
@@ -37,6 +38,7 @@ void initBlockTypes()
         block.transparent = true;
         block.connectsToSame = false;
         block.isLiquid = false;
+        block.lightEmission = 0;
         for (int i = 0; i < 6; i++)
         {
             block.faceTexture[i] = 0;
@@ -187,6 +189,13 @@ void initBlockTypes()
         setSideRotations(b);
     }
 
+    g_blockTypeCount = 0;
+    for (int id = 0; id < static_cast<int>(g_blockTypes.size()); id++)
+    {
+        if (g_blockTypes[id].solid || g_blockTypes[id].isLiquid)
+            g_blockTypeCount = id + 1;
+    }
+
     g_defaultBlockTypes = g_blockTypes;
 }
 
@@ -36,10 +36,14 @@ struct BlockType
     bool transparent;
     bool connectsToSame;
     bool isLiquid;
+    uint8_t lightEmission;
 };
 
 extern std::array<BlockType, 256> g_blockTypes;
 extern std::array<BlockType, 256> g_defaultBlockTypes;
+// One past the highest ID initBlockTypes defines; every defined block is solid
+// or liquid, and IDs from here up are unused.
+extern int g_blockTypeCount;
 
 void initBlockTypes();
 
@@ -55,6 +59,11 @@ inline bool isBlockTransparent(uint8_t blockId)
     return g_blockTypes[blockId].transparent;
 }
 
+inline uint8_t getBlockLightEmission(uint8_t blockId)
+{
+    return g_blockTypes[blockId].lightEmission;
+}
+
 inline bool isBlockLiquid(uint8_t blockId)
 {
     if (blockId == 0) return false;
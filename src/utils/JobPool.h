@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Recycles job objects so their fixed arrays and vector capacity survive
+// between requests. Not thread-safe: jobs are acquired and released by the
+// thread that owns the pool, never by workers.
+template <typename T>
+class JobPool
+{
+public:
+    std::unique_ptr<T> acquire()
+    {
+        if (freeJobs.empty())
+        {
+            allocations++;
+            return std::make_unique<T>();
+        }
+
+        std::unique_ptr<T> job = std::move(freeJobs.back());
+        freeJobs.pop_back();
+        return job;
+    }
+
+    void release(std::unique_ptr<T> job)
+    {
+        job->reset();
+        freeJobs.push_back(std::move(job));
+    }
+
+    size_t allocationCount() const { return allocations; }
+    size_t freeCount() const { return freeJobs.size(); }
+
+private:
+    std::vector<std::unique_ptr<T>> freeJobs;
+    size_t allocations = 0;
+};
@@ -6,13 +6,28 @@
 #include <algorithm>
 
 JobSystem::JobSystem()
-    : running(false), regionManager(nullptr), chunkManager(nullptr)
+    : nextQueue(0), pendingJobs(0), pendingHighPriorityJobs(0), completedJobs(0), meshBufferGrowths(0), sleepingWorkers(0),
+      running(false),
+      completedGenerations(nullptr), completedLights(nullptr), completedMeshes(nullptr), completedSaves(nullptr),
+      regionManager(nullptr), chunkManager(nullptr)
 {
+    queues.push_back(std::make_unique<WorkerQueue>());
 }
 
 JobSystem::~JobSystem()
 {
     stop();
+
+    for (std::atomic<Job*>* list : {&completedGenerations, &completedLights, &completedMeshes, &completedSaves})
+    {
+        Job* head = takeCompleted(*list);
+        while (head)
+        {
+            Job* next = head->nextCompleted;
+            delete head;
+            head = next;
+        }
+    }
 }
 
 void JobSystem::start(int numWorkers)
@@ -20,11 +35,17 @@ void JobSystem::start(int numWorkers)
     if (running)
         return;
 
+    numWorkers = (std::max)(1, numWorkers);
+    while (queues.size() < static_cast<size_t>(numWorkers))
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
     running = true;
 
     for (int i = 0; i < numWorkers; i++)
     {
-        workers.emplace_back(&JobSystem::workerLoop, this);
+        workers.emplace_back(&JobSystem::workerLoop, this, static_cast<size_t>(i));
     }
 }
 
@@ -34,6 +55,9 @@ void JobSystem::stop()
         return;
 
     running = false;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
     condition.notify_all();
 
     for (auto& worker : workers)
@@ -49,274 +73,333 @@ void JobSystem::stop()
 
 void JobSystem::enqueue(std::unique_ptr<Job> job)
 {
+    submit(std::move(job), false);
+}
+
+void JobSystem::enqueueHighPriority(std::unique_ptr<Job> job)
+{
+    submit(std::move(job), true);
+}
+
+void JobSystem::submit(std::unique_ptr<Job> job, bool highPriority)
+{
+    size_t index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    WorkerQueue& queue = *queues[index];
+
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        jobQueue.push(std::move(job));
+        // Counted under the queue lock so no worker can pop and decrement
+        // before the increment lands.
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (highPriority)
+        {
+            queue.highPriority.push_back(std::move(job));
+            pendingHighPriorityJobs.fetch_add(1);
+        }
+        else
+        {
+            queue.normal.push_back(std::move(job));
+        }
+        pendingJobs.fetch_add(1);
     }
-    condition.notify_one();
+
+    wakeWorker();
 }
 
-void JobSystem::enqueueHighPriority(std::unique_ptr<Job> job)
+void JobSystem::wakeWorker()
 {
+    // pendingJobs is bumped before sleepingWorkers is read, and a worker bumps
+    // sleepingWorkers before re-checking pendingJobs, so one side always sees
+    // the other and the mutex is only touched when somebody is actually asleep.
+    if (sleepingWorkers.load() == 0)
+        return;
+
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        highPriorityQueue.push(std::move(job));
+        std::lock_guard<std::mutex> lock(wakeMutex);
     }
     condition.notify_one();
 }
 
-std::vector<std::unique_ptr<GenerateChunkJob>> JobSystem::pollCompletedGenerations()
+// A worker takes from the front of its own queue, which holds its share of
+// submissions in the order ChunkManager scored them. Only when that is empty
+// does it steal, from the back of the other queues so owner and thief work
+// opposite ends. High priority queues are only scanned while some exist.
+std::unique_ptr<Job> JobSystem::tryPopJob(size_t workerIndex)
 {
-    std::lock_guard<std::mutex> lock(completedMutex);
-    std::vector<std::unique_ptr<GenerateChunkJob>> result;
-    result.swap(completedGenerations);
-    return result;
+    size_t queueCount = queues.size();
+    std::unique_ptr<Job> job;
+
+    auto popFrom = [&job](WorkerQueue& queue, bool highPriority, bool steal)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto& deque = highPriority ? queue.highPriority : queue.normal;
+        if (deque.empty())
+            return false;
+        if (steal)
+        {
+            job = std::move(deque.back());
+            deque.pop_back();
+        }
+        else
+        {
+            job = std::move(deque.front());
+            deque.pop_front();
+        }
+        return true;
+    };
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool highPriority = pass == 0;
+        if (highPriority && pendingHighPriorityJobs.load() == 0)
+            continue;
+
+        for (size_t i = 0; i < queueCount; i++)
+        {
+            WorkerQueue& queue = *queues[(workerIndex + i) % queueCount];
+            if (popFrom(queue, highPriority, i != 0))
+            {
+                if (highPriority)
+                    pendingHighPriorityJobs.fetch_sub(1);
+                pendingJobs.fetch_sub(1);
+                return job;
+            }
+        }
+    }
+
+    return nullptr;
 }
 
-std::vector<std::unique_ptr<MeshChunkJob>> JobSystem::pollCompletedMeshes()
+void JobSystem::pushCompleted(std::atomic<Job*>& list, Job* job)
 {
-    std::lock_guard<std::mutex> lock(completedMutex);
-    std::vector<std::unique_ptr<MeshChunkJob>> result;
-    result.swap(completedMeshes);
-    return result;
+    Job* head = list.load(std::memory_order_relaxed);
+    do
+    {
+        job->nextCompleted = head;
+    } while (!list.compare_exchange_weak(head, job,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
 }
 
-std::vector<std::unique_ptr<SaveChunkJob>> JobSystem::pollCompletedSaves()
+Job* JobSystem::takeCompleted(std::atomic<Job*>& list)
 {
-    std::lock_guard<std::mutex> lock(completedMutex);
-    std::vector<std::unique_ptr<SaveChunkJob>> result;
-    result.swap(completedSaves);
-    return result;
+    Job* head = list.exchange(nullptr, std::memory_order_acquire);
+
+    // The stack hands jobs back newest first; flip it to completion order.
+    Job* ordered = nullptr;
+    while (head)
+    {
+        Job* next = head->nextCompleted;
+        head->nextCompleted = ordered;
+        ordered = head;
+        head = next;
+    }
+    return ordered;
 }
 
-bool JobSystem::hasCompletedWork() const
+template <typename T>
+static void collectCompleted(Job* head, std::vector<std::unique_ptr<T>>& out)
 {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(completedMutex));
-    return !completedGenerations.empty() || !completedMeshes.empty() || !completedSaves.empty();
+    while (head)
+    {
+        Job* next = head->nextCompleted;
+        head->nextCompleted = nullptr;
+        out.emplace_back(static_cast<T*>(head));
+        head = next;
+    }
 }
 
-size_t JobSystem::pendingJobCount() const
+void JobSystem::pollCompletedGenerations(std::vector<std::unique_ptr<GenerateColumnJob>>& out)
 {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(queueMutex));
-    return jobQueue.size() + highPriorityQueue.size();
+    collectCompleted(takeCompleted(completedGenerations), out);
 }
 
-void JobSystem::workerLoop()
+void JobSystem::pollCompletedLights(std::vector<std::unique_ptr<LightChunkJob>>& out)
 {
-    while (running)
-    {
-        std::unique_ptr<Job> job;
+    collectCompleted(takeCompleted(completedLights), out);
+}
 
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
+void JobSystem::pollCompletedMeshes(std::vector<std::unique_ptr<MeshChunkJob>>& out)
+{
+    collectCompleted(takeCompleted(completedMeshes), out);
+}
 
-            condition.wait(lock, [this] {
-                return !running || !jobQueue.empty() || !highPriorityQueue.empty();
-            });
+void JobSystem::pollCompletedSaves(std::vector<std::unique_ptr<SaveChunkJob>>& out)
+{
+    collectCompleted(takeCompleted(completedSaves), out);
+}
 
-            if (!running && jobQueue.empty() && highPriorityQueue.empty())
-                break;
+bool JobSystem::hasCompletedWork() const
+{
+    return completedGenerations.load(std::memory_order_relaxed) != nullptr ||
+           completedLights.load(std::memory_order_relaxed) != nullptr ||
+           completedMeshes.load(std::memory_order_relaxed) != nullptr ||
+           completedSaves.load(std::memory_order_relaxed) != nullptr;
+}
 
-            if (!highPriorityQueue.empty())
-            {
-                job = std::move(highPriorityQueue.front());
-                highPriorityQueue.pop();
-            }
-            else if (!jobQueue.empty())
-            {
-                job = std::move(jobQueue.front());
-                jobQueue.pop();
-            }
-        }
+size_t JobSystem::pendingJobCount() const
+{
+    return pendingJobs.load(std::memory_order_relaxed);
+}
+
+void JobSystem::workerLoop(size_t workerIndex)
+{
+    while (running)
+    {
+        std::unique_ptr<Job> job = tryPopJob(workerIndex);
 
         if (job)
         {
             processJob(std::move(job));
+            continue;
         }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        sleepingWorkers.fetch_add(1);
+        condition.wait(lock, [this] {
+            return !running || pendingJobs.load() > 0;
+        });
+        sleepingWorkers.fetch_sub(1);
     }
 }
 
 void JobSystem::processJob(std::unique_ptr<Job> job)
 {
+    bool skip = job->cancelled.load(std::memory_order_relaxed);
+
     switch (job->type)
     {
         case JobType::Generate:
-            processGenerateJob(static_cast<GenerateChunkJob*>(job.get()));
-            {
-                std::lock_guard<std::mutex> lock(completedMutex);
-                completedGenerations.push_back(
-                    std::unique_ptr<GenerateChunkJob>(static_cast<GenerateChunkJob*>(job.release()))
-                );
-            }
+            if (!skip)
+                processGenerateJob(static_cast<GenerateColumnJob*>(job.get()));
+            pushCompleted(completedGenerations, job.release());
+            break;
+
+        case JobType::Light:
+            if (!skip)
+                processLightJob(static_cast<LightChunkJob*>(job.get()));
+            pushCompleted(completedLights, job.release());
             break;
 
         case JobType::Mesh:
-            processMeshJob(static_cast<MeshChunkJob*>(job.get()));
-            {
-                std::lock_guard<std::mutex> lock(completedMutex);
-                completedMeshes.push_back(
-                    std::unique_ptr<MeshChunkJob>(static_cast<MeshChunkJob*>(job.release()))
-                );
-            }
+            if (!skip)
+                processMeshJob(static_cast<MeshChunkJob*>(job.get()));
+            pushCompleted(completedMeshes, job.release());
             break;
 
         case JobType::Save:
             processSaveJob(static_cast<SaveChunkJob*>(job.get()));
-            {
-                std::lock_guard<std::mutex> lock(completedMutex);
-                completedSaves.push_back(
-                    std::unique_ptr<SaveChunkJob>(static_cast<SaveChunkJob*>(job.release()))
-                );
-            }
+            pushCompleted(completedSaves, job.release());
             break;
     }
-}
 
-void JobSystem::processGenerateJob(GenerateChunkJob* job)
-{
-  std::fill(std::begin(job->blocks), std::end(job->blocks), 0);
-  std::fill(std::begin(job->skyLight), std::end(job->skyLight), MAX_SKY_LIGHT);
-
-  if (regionManager && regionManager->loadChunkData(job->cx, job->cy, job->cz, job->blocks))
-  {
-    job->loadedFromDisk = true;
-  }
-  else
-  {
-    generateTerrain(job->blocks, job->cx, job->cy, job->cz);
-    job->loadedFromDisk = false;
-
-    // Compute terrain heights for this chunk's XZ columns
-    int terrainHeights[CHUNK_SIZE * CHUNK_SIZE];
-    getTerrainHeightsForChunk(job->cx, job->cz, terrainHeights);
-    
-    // Carve caves only on freshly generated chunks (not on loaded/saved ones)
-    applyCavesToBlocks(job->blocks, glm::ivec3(job->cx, job->cy, job->cz), DEFAULT_WORLD_SEED, terrainHeights);
-  }
+    completedJobs.fetch_add(1, std::memory_order_relaxed);
 }
 
-void JobSystem::processMeshJob(MeshChunkJob* job)
+void JobSystem::processGenerateJob(GenerateColumnJob* job)
 {
-    auto getBlock = [job](int x, int y, int z) -> BlockID
+    if (regionManager)
+        job->loadedFromDisk = regionManager->loadColumnData(job->cx, job->cz, job->sections, job->blocks[0],
+                                                            job->light[0], &job->lightFromDisk);
+
+    bool terrainReady = false;
+    for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
     {
-        if (x >= 0 && x < CHUNK_SIZE &&
-            y >= 0 && y < CHUNK_SIZE &&
-            z >= 0 && z < CHUNK_SIZE)
-        {
-            return job->blocks[blockIndex(x, y, z)];
-        }
+        uint32_t bit = 1u << cy;
+        if (!(job->sections & bit))
+            continue;
 
-        if (x >= CHUNK_SIZE && job->hasNeighborPosX)
-        {
-            int localY = y;
-            int localZ = z;
-            if (localY >= 0 && localY < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->neighborPosX[localY * CHUNK_SIZE + localZ];
-        }
-        if (x < 0 && job->hasNeighborNegX)
-        {
-            int localY = y;
-            int localZ = z;
-            if (localY >= 0 && localY < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->neighborNegX[localY * CHUNK_SIZE + localZ];
-        }
-        if (y >= CHUNK_SIZE && job->hasNeighborPosY)
-        {
-            int localX = x;
-            int localZ = z;
-            if (localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->neighborPosY[localX * CHUNK_SIZE + localZ];
-        }
-        if (y < 0 && job->hasNeighborNegY)
+        BlockID* blocks = job->blocks[cy];
+        if (!(job->loadedFromDisk & bit))
         {
-            int localX = x;
-            int localZ = z;
-            if (localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->neighborNegY[localX * CHUNK_SIZE + localZ];
-        }
-        if (z >= CHUNK_SIZE && job->hasNeighborPosZ)
-        {
-            int localX = x;
-            int localY = y;
-            if (localX >= 0 && localX < CHUNK_SIZE && localY >= 0 && localY < CHUNK_SIZE)
-                return job->neighborPosZ[localX * CHUNK_SIZE + localY];
-        }
-        if (z < 0 && job->hasNeighborNegZ)
-        {
-            int localX = x;
-            int localY = y;
-            if (localX >= 0 && localX < CHUNK_SIZE && localY >= 0 && localY < CHUNK_SIZE)
-                return job->neighborNegZ[localX * CHUNK_SIZE + localY];
-        }
+            if (!terrainReady)
+            {
+                computeColumnTerrain(job->cx, job->cz, job->terrain);
+                terrainReady = true;
+            }
 
-        return 0;
-    };
+            if (uniformSection(job->terrain, cy, job->uniformBlocks[cy]))
+            {
+                job->uniform |= bit;
+                continue;
+            }
 
-    auto getSkyLight = [job](int x, int y, int z) -> uint8_t
-    {
-        if (x >= 0 && x < CHUNK_SIZE &&
-            y >= 0 && y < CHUNK_SIZE &&
-            z >= 0 && z < CHUNK_SIZE)
-        {
-            return job->skyLight[blockIndex(x, y, z)];
-        }
+            std::fill(blocks, blocks + CHUNK_VOLUME, 0);
+            generateTerrain(blocks, job->terrain, cy);
 
-        if (x >= CHUNK_SIZE && job->hasNeighborPosX)
-        {
-            int localY = y;
-            int localZ = z;
-            if (localY >= 0 && localY < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->skyLightPosX[localY * CHUNK_SIZE + localZ];
-        }
-        if (x < 0 && job->hasNeighborNegX)
-        {
-            int localY = y;
-            int localZ = z;
-            if (localY >= 0 && localY < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->skyLightNegX[localY * CHUNK_SIZE + localZ];
+            // Carve caves only on freshly generated chunks (not on loaded/saved ones)
+            applyCavesToBlocks(blocks, glm::ivec3(job->cx, cy, job->cz), DEFAULT_WORLD_SEED, job->terrain.maps->heights);
         }
-        if (y >= CHUNK_SIZE && job->hasNeighborPosY)
+    }
+
+    // Sky light runs top-down through the column. Below a section this job
+    // does not cover, the sky is assumed open and the light stage corrects it.
+    // Sections with stored light keep it and pass it on downwards.
+    uint8_t incoming[CHUNK_SIZE * CHUNK_SIZE];
+    bool openSky = true;
+    bool traced = true;
+    for (int cy = WORLD_HEIGHT_CHUNKS - 1; cy >= 0; cy--)
+    {
+        uint32_t bit = 1u << cy;
+        if (!(job->sections & bit))
         {
-            int localX = x;
-            int localZ = z;
-            if (localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->skyLightPosY[localX * CHUNK_SIZE + localZ];
+            openSky = true;
+            traced = false;
+            continue;
         }
-        if (y < 0 && job->hasNeighborNegY)
+        if (job->lightFromDisk & bit)
+            traced = true;
+        if (traced)
+            job->skyLit |= bit;
+
+        BlockID* blocks = job->blocks[cy];
+        uint8_t* light = job->light[cy];
+
+        if (job->uniform & bit)
         {
-            int localX = x;
-            int localZ = z;
-            if (localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE)
-                return job->skyLightNegY[localX * CHUNK_SIZE + localZ];
+            if (openSky && job->uniformBlocks[cy] == 0)
+                continue;
+            std::fill(blocks, blocks + CHUNK_VOLUME, job->uniformBlocks[cy]);
+            job->uniform &= ~bit;
         }
-        if (z >= CHUNK_SIZE && job->hasNeighborPosZ)
+
+        if (!(job->lightFromDisk & bit))
         {
-            int localX = x;
-            int localY = y;
-            if (localX >= 0 && localX < CHUNK_SIZE && localY >= 0 && localY < CHUNK_SIZE)
-                return job->skyLightPosZ[localX * CHUNK_SIZE + localY];
+            computeSectionSkyLight(blocks, openSky ? nullptr : incoming, light);
+            propagateBlockLight(blocks, light);
         }
-        if (z < 0 && job->hasNeighborNegZ)
+
+        openSky = true;
+        for (int z = 0; z < CHUNK_SIZE; z++)
         {
-            int localX = x;
-            int localY = y;
-            if (localX >= 0 && localX < CHUNK_SIZE && localY >= 0 && localY < CHUNK_SIZE)
-                return job->skyLightNegZ[localX * CHUNK_SIZE + localY];
+            for (int x = 0; x < CHUNK_SIZE; x++)
+            {
+                incoming[z * CHUNK_SIZE + x] = skyLightOf(light[blockIndex(x, 0, z)]);
+                openSky = openSky && incoming[z * CHUNK_SIZE + x] == MAX_SKY_LIGHT;
+            }
         }
+    }
+}
 
-        return MAX_SKY_LIGHT;
-    };
+void JobSystem::processLightJob(LightChunkJob* job)
+{
+    computeChunkLight(job->volume, job->neighborMask, job->cy == WORLD_HEIGHT_CHUNKS - 1, job->light);
+}
 
-    glm::ivec3 chunkWorldOrigin(job->cx * CHUNK_SIZE, job->cy * CHUNK_SIZE, job->cz * CHUNK_SIZE);
-    buildChunkMeshOffThread(job->blocks, job->skyLight, chunkWorldOrigin, getBlock, getSkyLight, 
-                             job->vertices, job->indices,
-                             job->waterVertices, job->waterIndices);
+void JobSystem::processMeshJob(MeshChunkJob* job)
+{
+    size_t capacity = job->vertices.capacity();
+    size_t waterCapacity = job->waterVertices.capacity();
+    buildChunkMeshOffThread(job->volume, job->vertices, job->waterVertices);
+    uint64_t growths = (job->vertices.capacity() > capacity ? 1 : 0) +
+                       (job->waterVertices.capacity() > waterCapacity ? 1 : 0);
+    if (growths)
+        meshBufferGrowths.fetch_add(growths, std::memory_order_relaxed);
 }
 
 void JobSystem::processSaveJob(SaveChunkJob* job)
 {
     if (regionManager)
     {
-        regionManager->saveChunkData(job->cx, job->cy, job->cz, job->blocks);
+        regionManager->saveChunkData(job->cx, job->cy, job->cz, job->blocks, job->hasLight ? job->light : nullptr);
     }
 }
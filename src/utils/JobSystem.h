@@ -2,18 +2,21 @@
 #include "../world/Chunk.h"
 #include "../rendering/Meshing.h"
 #include "../world/RegionManager.h"
+#include "../world/TerrainGenerator.h"
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 enum class JobType
 {
     Generate,
+    Light,
     Mesh,
     Save
 };
@@ -23,64 +26,115 @@ struct Job
     JobType type;
     int cx, cy, cz;
 
+    // Set by the owner when the result is no longer wanted. Workers skip
+    // cancelled jobs but still hand them back so bookkeeping can be cleared.
+    std::atomic<bool> cancelled{false};
+
+    // Intrusive link used by the lock-free completion lists.
+    Job* nextCompleted = nullptr;
+
     virtual ~Job() = default;
+
+    void reset()
+    {
+        cancelled.store(false, std::memory_order_relaxed);
+        nextCompleted = nullptr;
+    }
 };
 
-struct GenerateChunkJob : Job
+// Generates the requested sections of one chunk column, so the 2D terrain
+// fields and the region read are done once for all of them. cy is unused.
+struct GenerateColumnJob : Job
 {
-    BlockID blocks[CHUNK_VOLUME];
-    uint8_t skyLight[CHUNK_VOLUME];
-    bool loadedFromDisk;
-
-    GenerateChunkJob()
+    uint32_t sections;
+    uint32_t loadedFromDisk;
+    // Sections whose light was stored with their blocks.
+    uint32_t lightFromDisk;
+    // Sections whose sky light was traced down from the top of the world,
+    // i.e. every section above them was part of this job too or came with
+    // its light from disk.
+    uint32_t skyLit;
+    // Sections of a single block, uniformBlocks[cy], under open sky. Their
+    // blocks and light arrays are left unwritten.
+    uint32_t uniform;
+    BlockID uniformBlocks[WORLD_HEIGHT_CHUNKS];
+    BlockID blocks[WORLD_HEIGHT_CHUNKS][CHUNK_VOLUME];
+    uint8_t light[WORLD_HEIGHT_CHUNKS][CHUNK_VOLUME];
+    ColumnTerrain terrain;
+
+    GenerateColumnJob()
     {
         type = JobType::Generate;
-        loadedFromDisk = false;
+        cy = 0;
+        sections = 0;
+        loadedFromDisk = 0;
+        lightFromDisk = 0;
+        skyLit = 0;
+        uniform = 0;
+    }
+
+    void reset()
+    {
+        Job::reset();
+        sections = 0;
+        loadedFromDisk = 0;
+        lightFromDisk = 0;
+        skyLit = 0;
+        uniform = 0;
+        terrain.maps.reset();
+    }
+};
+
+// Relights one chunk from a snapshot of it and its face neighbours.
+struct LightChunkJob : Job
+{
+    PaddedChunkVolume volume;
+    uint8_t neighborMask;
+    uint8_t light[CHUNK_VOLUME];
+
+    LightChunkJob()
+    {
+        type = JobType::Light;
+        neighborMask = 0;
     }
 };
 
 struct MeshChunkJob : Job
 {
-    BlockID blocks[CHUNK_VOLUME];
-    BlockID neighborPosX[CHUNK_SIZE * CHUNK_SIZE];
-    BlockID neighborNegX[CHUNK_SIZE * CHUNK_SIZE];
-    BlockID neighborPosY[CHUNK_SIZE * CHUNK_SIZE];
-    BlockID neighborNegY[CHUNK_SIZE * CHUNK_SIZE];
-    BlockID neighborPosZ[CHUNK_SIZE * CHUNK_SIZE];
-    BlockID neighborNegZ[CHUNK_SIZE * CHUNK_SIZE];
-    bool hasNeighborPosX, hasNeighborNegX;
-    bool hasNeighborPosY, hasNeighborNegY;
-    bool hasNeighborPosZ, hasNeighborNegZ;
-
-    uint8_t skyLight[CHUNK_VOLUME];
-    uint8_t skyLightPosX[CHUNK_SIZE * CHUNK_SIZE];
-    uint8_t skyLightNegX[CHUNK_SIZE * CHUNK_SIZE];
-    uint8_t skyLightPosY[CHUNK_SIZE * CHUNK_SIZE];
-    uint8_t skyLightNegY[CHUNK_SIZE * CHUNK_SIZE];
-    uint8_t skyLightPosZ[CHUNK_SIZE * CHUNK_SIZE];
-    uint8_t skyLightNegZ[CHUNK_SIZE * CHUNK_SIZE];
+    PaddedChunkVolume volume;
+    // The chunk's meshRevision when volume was copied.
+    uint32_t meshRevision;
 
     std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
     std::vector<Vertex> waterVertices;
-    std::vector<uint32_t> waterIndices;
 
     MeshChunkJob()
     {
         type = JobType::Mesh;
-        hasNeighborPosX = hasNeighborNegX = false;
-        hasNeighborPosY = hasNeighborNegY = false;
-        hasNeighborPosZ = hasNeighborNegZ = false;
+        meshRevision = 0;
+    }
+
+    // Clears the mesh output but keeps its capacity for the next request.
+    void reset()
+    {
+        Job::reset();
+        vertices.clear();
+        waterVertices.clear();
     }
 };
 
 struct SaveChunkJob : Job
 {
     BlockID blocks[CHUNK_VOLUME];
+    // Light is saved only when it had settled; otherwise it is recomputed
+    // after the next load.
+    bool hasLight;
+    uint8_t light[CHUNK_VOLUME];
 
     SaveChunkJob()
     {
         type = JobType::Save;
+        hasLight = false;
     }
 };
 
@@ -101,32 +155,62 @@ public:
     void enqueue(std::unique_ptr<Job> job);
     void enqueueHighPriority(std::unique_ptr<Job> job);
 
-    std::vector<std::unique_ptr<GenerateChunkJob>> pollCompletedGenerations();
-    std::vector<std::unique_ptr<MeshChunkJob>> pollCompletedMeshes();
-    std::vector<std::unique_ptr<SaveChunkJob>> pollCompletedSaves();
+    void pollCompletedGenerations(std::vector<std::unique_ptr<GenerateColumnJob>>& out);
+    void pollCompletedLights(std::vector<std::unique_ptr<LightChunkJob>>& out);
+    void pollCompletedMeshes(std::vector<std::unique_ptr<MeshChunkJob>>& out);
+    void pollCompletedSaves(std::vector<std::unique_ptr<SaveChunkJob>>& out);
 
     bool hasCompletedWork() const;
     size_t pendingJobCount() const;
+    size_t workerCount() const { return workers.size(); }
+    uint64_t completedJobCount() const { return completedJobs.load(std::memory_order_relaxed); }
+    // Times a pooled mesh job's vertex vectors had to grow, i.e. heap
+    // allocations made while meshing.
+    uint64_t meshBufferGrowthCount() const { return meshBufferGrowths.load(std::memory_order_relaxed); }
 
 private:
+    // Each worker owns a pair of deques. Submissions are spread round-robin;
+    // a worker drains its own queue and steals from the others only once it
+    // is empty, before going to sleep.
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Job>> highPriority;
+        std::deque<std::unique_ptr<Job>> normal;
+    };
+
     std::vector<std::thread> workers;
-    std::queue<std::unique_ptr<Job>> jobQueue;
-    std::queue<std::unique_ptr<Job>> highPriorityQueue;
-    std::mutex queueMutex;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<uint32_t> nextQueue;
+    std::atomic<size_t> pendingJobs;
+    // Lets workers skip the high priority scan, and its locks, when it is zero.
+    std::atomic<size_t> pendingHighPriorityJobs;
+    std::atomic<uint64_t> completedJobs;
+    std::atomic<uint64_t> meshBufferGrowths;
+    std::atomic<int> sleepingWorkers;
+    std::mutex wakeMutex;
     std::condition_variable condition;
     std::atomic<bool> running;
 
-    std::vector<std::unique_ptr<GenerateChunkJob>> completedGenerations;
-    std::vector<std::unique_ptr<MeshChunkJob>> completedMeshes;
-    std::vector<std::unique_ptr<SaveChunkJob>> completedSaves;
-    std::mutex completedMutex;
+    std::atomic<Job*> completedGenerations;
+    std::atomic<Job*> completedLights;
+    std::atomic<Job*> completedMeshes;
+    std::atomic<Job*> completedSaves;
 
     RegionManager* regionManager;
     ChunkManager* chunkManager;
 
-    void workerLoop();
+    void submit(std::unique_ptr<Job> job, bool highPriority);
+    std::unique_ptr<Job> tryPopJob(size_t workerIndex);
+    void wakeWorker();
+
+    static void pushCompleted(std::atomic<Job*>& list, Job* job);
+    static Job* takeCompleted(std::atomic<Job*>& list);
+
+    void workerLoop(size_t workerIndex);
     void processJob(std::unique_ptr<Job> job);
-    void processGenerateJob(GenerateChunkJob* job);
+    void processGenerateJob(GenerateColumnJob* job);
+    void processLightJob(LightChunkJob* job);
     void processMeshJob(MeshChunkJob* job);
     void processSaveJob(SaveChunkJob* job);
 };
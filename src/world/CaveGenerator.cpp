@@ -1,100 +1,8 @@
 #include "CaveGenerator.h"
-#include <array>
+#include "Perlin3D.h"
+#include <algorithm>
 #include <cmath>
 
-class Perlin3D
-{
-public:
-  Perlin3D() = default;
-  explicit Perlin3D(uint32_t seed) { reseed(seed); }
-
-  void reseed(uint32_t seed)
-  {
-    uint32_t x = seed;
-    for (int i = 0; i < 256; ++i)
-    {
-      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
-      perm[i] = static_cast<uint8_t>(x & 255u);
-    }
-    // fisher-yates shuffle
-    for (int i = 255; i > 0; --i)
-    {
-      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
-      uint32_t j = x % static_cast<uint32_t>(i + 1);
-      std::swap(perm[i], perm[j]);
-    }
-    for (int i = 0; i < 256; ++i)
-      perm[256 + i] = perm[i];
-  }
-
-  float noise(float x, float y, float z) const
-  {
-    int X = static_cast<int>(std::floor(x)) & 255;
-    int Y = static_cast<int>(std::floor(y)) & 255;
-    int Z = static_cast<int>(std::floor(z)) & 255;
-
-    x -= std::floor(x);
-    y -= std::floor(y);
-    z -= std::floor(z);
-
-    float u = fade(x);
-    float v = fade(y);
-    float w = fade(z);
-
-    int A  = perm[X] + Y;
-    int AA = perm[A] + Z;
-    int AB = perm[A + 1] + Z;
-    int B  = perm[X + 1] + Y;
-    int BA = perm[B] + Z;
-    int BB = perm[B + 1] + Z;
-
-    float g000 = grad(perm[AA],     x,     y,     z    );
-    float g100 = grad(perm[BA],     x-1.0f,y,     z    );
-    float g010 = grad(perm[AB],     x,     y-1.0f,z    );
-    float g110 = grad(perm[BB],     x-1.0f,y-1.0f,z    );
-    float g001 = grad(perm[AA+1],   x,     y,     z-1.0f);
-    float g101 = grad(perm[BA+1],   x-1.0f,y,     z-1.0f);
-    float g011 = grad(perm[AB+1],   x,     y-1.0f,z-1.0f);
-    float g111 = grad(perm[BB+1],   x-1.0f,y-1.0f,z-1.0f);
-
-    float lerpX1 = lerp(u, g000, g100);
-    float lerpX2 = lerp(u, g010, g110);
-    float lerpX3 = lerp(u, g001, g101);
-    float lerpX4 = lerp(u, g011, g111);
-
-    float lerpY1 = lerp(v, lerpX1, lerpX2);
-    float lerpY2 = lerp(v, lerpX3, lerpX4);
-
-    return lerp(w, lerpY1, lerpY2); // ~[-1,1]
-  }
-
-  float fbm(float x, float y, float z, int octaves, float gain, float freq) const
-  {
-    float amp = 1.0f;
-    float sum = 0.0f;
-    for (int i = 0; i < octaves; ++i)
-    {
-      sum += amp * noise(x * freq, y * freq, z * freq);
-      freq *= 2.0f;
-      amp *= gain;
-    }
-    return sum;
-  }
-
-private:
-  std::array<uint8_t, 512> perm{};
-
-  static inline float fade(float t) { return t*t*t*(t*(t*6.0f-15.0f)+10.0f); }
-  static inline float lerp(float t, float a, float b) { return a + t * (b - a); }
-  static inline float grad(uint8_t h, float x, float y, float z)
-  {
-    int g = h & 15;
-    float u = g < 8 ? x : y;
-    float v = g < 4 ? y : (g == 12 || g == 14 ? x : z);
-    return ((g & 1) ? -u : u) + ((g & 2) ? -v : v);
-  }
-};
-
 struct CaveNoiseSet
 {
   Perlin3D shape;
@@ -132,19 +40,19 @@ static const CaveNoiseSet& getNoise(uint32_t seed)
   return g_noiseCache;
 }
 
-float caveDensity(int wx, int wy, int wz, int terrainHeight, uint32_t seed, const CaveConfig& cfg)
+struct CaveFields
 {
-  const CaveNoiseSet& noise = getNoise(seed);
-
-  float sx = static_cast<float>(wx);
-  float sy = static_cast<float>(wy);
-  float sz = static_cast<float>(wz);
+  float cheese;
+  float spaghetti1;
+  float spaghetti2;
+};
 
-  if (wy < cfg.minCaveHeight) return -1.0f;
-  if (wy > terrainHeight - cfg.surfaceMargin) return -1.0f;
+static CaveFields sampleCaveFields(const CaveNoiseSet& noise, float sx, float sy, float sz, const CaveConfig& cfg)
+{
+  CaveFields f;
 
   //  chez
-  float cheeseNoise = noise.shape.fbm(
+  f.cheese = noise.shape.fbm(
     sx * cfg.cheeseFrequency,
     sy * cfg.cheeseFrequency * 0.8f,  
     sz * cfg.cheeseFrequency,
@@ -152,41 +60,66 @@ float caveDensity(int wx, int wy, int wz, int terrainHeight, uint32_t seed, cons
     cfg.cheeseGain,
     1.0f
   );
-  
-  bool isCheeseCave = cheeseNoise < cfg.cheeseThreshold;
-  
+
   // spaget
   float yStretched = sy * cfg.spaghettiYStretch;
   
-  float spaghetti1 = noise.detail.noise(
+  f.spaghetti1 = noise.detail.noise(
     sx * cfg.spaghettiFrequency,
     yStretched * cfg.spaghettiFrequency,
     sz * cfg.spaghettiFrequency
   );
   
-  float spaghetti2 = noise.veg.noise(
+  f.spaghetti2 = noise.veg.noise(
     sx * cfg.spaghettiFrequency + 500.0f,
     yStretched * cfg.spaghettiFrequency,
     sz * cfg.spaghettiFrequency + 500.0f
   );
-  
-  bool isSpaghettiCave = (std::abs(spaghetti1) < cfg.spaghettiThreshold) && 
-                         (std::abs(spaghetti2) < cfg.spaghettiThreshold);
 
-  bool isCave = isCheeseCave || isSpaghettiCave;
-  
-  if (!isCave) return -1.0f;
+  return f;
+}
+
+// Caller has already checked wy against minCaveHeight and the surface margin.
+static bool isCave(const CaveNoiseSet& noise, const CaveFields& f, int wx, int wy, int wz, int terrainHeight, const CaveConfig& cfg)
+{
+  bool isCheeseCave = f.cheese < cfg.cheeseThreshold;
+  bool isSpaghettiCave = (std::abs(f.spaghetti1) < cfg.spaghettiThreshold) && 
+                         (std::abs(f.spaghetti2) < cfg.spaghettiThreshold);
+
+  if (!isCheeseCave && !isSpaghettiCave) return false;
   
   float distToSurface = static_cast<float>(terrainHeight - cfg.surfaceMargin - wy);
   if (distToSurface < 5.0f && distToSurface > 0.0f) {
     float fade = distToSurface / 5.0f;
-    float fadeNoise = noise.detail.noise(sx * 0.1f, sy * 0.1f, sz * 0.1f);
+    float fadeNoise = noise.detail.noise(wx * 0.1f, wy * 0.1f, wz * 0.1f);
     if (fadeNoise > fade * 2.0f - 1.0f) {
-      return -1.0f;  
+      return false;  
     }
   }
 
-  return 1.0f; 
+  return true;
+}
+
+static bool inCaveRange(int wy, int terrainHeight, const CaveConfig& cfg)
+{
+  return wy >= cfg.minCaveHeight && wy <= terrainHeight - cfg.surfaceMargin;
+}
+
+bool sectionMayHaveCaves(int cy, int maxTerrainHeight, const CaveConfig& cfg)
+{
+  int bottomY = cy * CHUNK_SIZE;
+  int topY = bottomY + CHUNK_SIZE - 1;
+  return topY >= static_cast<int>(std::ceil(cfg.minCaveHeight)) &&
+         bottomY <= static_cast<int>(std::floor(maxTerrainHeight - cfg.surfaceMargin));
+}
+
+float caveDensity(int wx, int wy, int wz, int terrainHeight, uint32_t seed, const CaveConfig& cfg)
+{
+  if (!inCaveRange(wy, terrainHeight, cfg)) return -1.0f;
+
+  const CaveNoiseSet& noise = getNoise(seed);
+  CaveFields f = sampleCaveFields(noise, static_cast<float>(wx), static_cast<float>(wy), static_cast<float>(wz), cfg);
+  return isCave(noise, f, wx, wy, wz, terrainHeight, cfg) ? 1.0f : -1.0f;
 }
 
 bool caveVegetationMask(int wx, int wy, int wz, uint32_t seed, const CaveConfig& cfg)
@@ -196,6 +129,49 @@ bool caveVegetationMask(int wx, int wy, int wz, uint32_t seed, const CaveConfig&
   return n > cfg.vegThreshold;
 }
 
+// The cave fields are smooth at their frequencies, so applyCavesToBlocks
+// samples them on a lattice every CAVE_STEP_XZ x CAVE_STEP_Y x CAVE_STEP_XZ
+// blocks and interpolates them trilinearly before thresholding each voxel.
+constexpr int CAVE_STEP_XZ = 4;
+constexpr int CAVE_STEP_Y = 8;
+constexpr int CAVE_NODES_XZ = CHUNK_SIZE / CAVE_STEP_XZ + 1;
+constexpr int CAVE_NODES_Y = CHUNK_SIZE / CAVE_STEP_Y + 1;
+
+// sampleCaveFields for count points at once.
+static void sampleCaveFieldsBatch(const CaveNoiseSet& noise, const float* sx, const float* sy, const float* sz,
+                                  int count, const CaveConfig& cfg, CaveFields* out)
+{
+  constexpr int MAX_POINTS = CAVE_NODES_Y * CAVE_NODES_XZ * CAVE_NODES_XZ;
+  float x[MAX_POINTS], y[MAX_POINTS], z[MAX_POINTS];
+  float cheese[MAX_POINTS], spaghetti1[MAX_POINTS], spaghetti2[MAX_POINTS];
+
+  for (int i = 0; i < count; ++i)
+  {
+    x[i] = sx[i] * cfg.cheeseFrequency;
+    y[i] = sy[i] * cfg.cheeseFrequency * 0.8f;
+    z[i] = sz[i] * cfg.cheeseFrequency;
+  }
+  noise.shape.fbmBatch(x, y, z, count, cfg.cheeseOctaves, cfg.cheeseGain, 1.0f, cheese);
+
+  for (int i = 0; i < count; ++i)
+  {
+    x[i] = sx[i] * cfg.spaghettiFrequency;
+    y[i] = sy[i] * cfg.spaghettiYStretch * cfg.spaghettiFrequency;
+    z[i] = sz[i] * cfg.spaghettiFrequency;
+  }
+  noise.detail.noiseBatch(x, y, z, count, 1.0f, spaghetti1);
+
+  for (int i = 0; i < count; ++i)
+  {
+    x[i] += 500.0f;
+    z[i] += 500.0f;
+  }
+  noise.veg.noiseBatch(x, y, z, count, 1.0f, spaghetti2);
+
+  for (int i = 0; i < count; ++i)
+    out[i] = CaveFields{cheese[i], spaghetti1[i], spaghetti2[i]};
+}
+
 void applyCavesToBlocks(BlockID* blocks, const glm::ivec3& chunkPos, uint32_t worldSeed, 
                         const int* terrainHeights, const CaveConfig& cfg, bool* outVegetationMask)
 {
@@ -203,45 +179,134 @@ void applyCavesToBlocks(BlockID* blocks, const glm::ivec3& chunkPos, uint32_t wo
   const int baseY = chunkPos.y * CHUNK_SIZE;
   const int baseZ = chunkPos.z * CHUNK_SIZE;
 
+  if (outVegetationMask)
+    std::fill(outVegetationMask, outVegetationMask + CHUNK_VOLUME, false);
+
+  int maxTerrainHeight = 60;
+  if (terrainHeights)
+    maxTerrainHeight = *std::max_element(terrainHeights, terrainHeights + CHUNK_SIZE * CHUNK_SIZE);
+
+  // Local y range that can hold caves anywhere in the section.
+  int yLo = std::max(0, static_cast<int>(std::ceil(cfg.minCaveHeight)) - baseY);
+  int yHi = std::min(CHUNK_SIZE - 1, static_cast<int>(std::floor(maxTerrainHeight - cfg.surfaceMargin)) - baseY);
+  if (yLo > yHi)
+    return;
+
+  const CaveNoiseSet& noise = getNoise(worldSeed);
+
+  CaveFields lattice[CAVE_NODES_Y][CAVE_NODES_XZ][CAVE_NODES_XZ];
+  int nodeYLo = yLo / CAVE_STEP_Y;
+  int nodeYHi = yHi / CAVE_STEP_Y + 1;
+
+  constexpr int PLANE_NODES = CAVE_NODES_XZ * CAVE_NODES_XZ;
+  float nodeX[CAVE_NODES_Y * PLANE_NODES];
+  float nodeY[CAVE_NODES_Y * PLANE_NODES];
+  float nodeZ[CAVE_NODES_Y * PLANE_NODES];
+  int nodeCount = 0;
+  for (int ny = nodeYLo; ny <= nodeYHi; ++ny)
+  {
+    for (int nz = 0; nz < CAVE_NODES_XZ; ++nz)
+    {
+      for (int nx = 0; nx < CAVE_NODES_XZ; ++nx)
+      {
+        nodeX[nodeCount] = static_cast<float>(baseX + nx * CAVE_STEP_XZ);
+        nodeY[nodeCount] = static_cast<float>(baseY + ny * CAVE_STEP_Y);
+        nodeZ[nodeCount] = static_cast<float>(baseZ + nz * CAVE_STEP_XZ);
+        nodeCount++;
+      }
+    }
+  }
+  sampleCaveFieldsBatch(noise, nodeX, nodeY, nodeZ, nodeCount, cfg, &lattice[nodeYLo][0][0]);
+
+  bool carved[CHUNK_VOLUME] = {};
+
   for (int z = 0; z < CHUNK_SIZE; ++z)
   {
+    int nz = z / CAVE_STEP_XZ;
+    float tz = static_cast<float>(z % CAVE_STEP_XZ) / CAVE_STEP_XZ;
+
     for (int x = 0; x < CHUNK_SIZE; ++x)
     {
+      int nx = x / CAVE_STEP_XZ;
+      float tx = static_cast<float>(x % CAVE_STEP_XZ) / CAVE_STEP_XZ;
       int terrainHeight = terrainHeights ? terrainHeights[z * CHUNK_SIZE + x] : 60;
+
+      // Fields along this voxel column at the two lattice planes around it.
+      auto columnAt = [&](int ny)
+      {
+        const CaveFields& a = lattice[ny][nz][nx];
+        const CaveFields& b = lattice[ny][nz][nx + 1];
+        const CaveFields& c = lattice[ny][nz + 1][nx];
+        const CaveFields& d = lattice[ny][nz + 1][nx + 1];
+        auto bilerp = [tx, tz](float va, float vb, float vc, float vd)
+        {
+          float front = va + (vb - va) * tx;
+          float back = vc + (vd - vc) * tx;
+          return front + (back - front) * tz;
+        };
+        return CaveFields{
+          bilerp(a.cheese, b.cheese, c.cheese, d.cheese),
+          bilerp(a.spaghetti1, b.spaghetti1, c.spaghetti1, d.spaghetti1),
+          bilerp(a.spaghetti2, b.spaghetti2, c.spaghetti2, d.spaghetti2)};
+      };
+
+      CaveFields below{};
+      CaveFields above{};
+      int loadedPlane = -1;
       
-      for (int y = 0; y < CHUNK_SIZE; ++y)
+      for (int y = yLo; y <= yHi; ++y)
       {
         int wx = baseX + x;
         int wy = baseY + y;
         int wz = baseZ + z;
+        if (!inCaveRange(wy, terrainHeight, cfg))
+          continue;
 
-        float d = caveDensity(wx, wy, wz, terrainHeight, worldSeed, cfg);
-        int i = blockIndex(x, y, z);
-
-        if (d > 0.0f)
+        int ny = y / CAVE_STEP_Y;
+        if (ny != loadedPlane)
         {
-          blocks[i] = 0; // carve to air
-          if (outVegetationMask)
-            outVegetationMask[i] = false;
+          below = columnAt(ny);
+          above = columnAt(ny + 1);
+          loadedPlane = ny;
         }
-        else if (outVegetationMask)
+        float ty = static_cast<float>(y % CAVE_STEP_Y) / CAVE_STEP_Y;
+        CaveFields f{
+          below.cheese + (above.cheese - below.cheese) * ty,
+          below.spaghetti1 + (above.spaghetti1 - below.spaghetti1) * ty,
+          below.spaghetti2 + (above.spaghetti2 - below.spaghetti2) * ty};
+
+        if (isCave(noise, f, wx, wy, wz, terrainHeight, cfg))
         {
-          bool isFloor = false;
-          if (y + 1 < CHUNK_SIZE)
-          {
-            float above = caveDensity(wx, wy + 1, wz, terrainHeight, worldSeed, cfg);
-            if (above > 0.0f)
-              isFloor = true;
-          }
-          outVegetationMask[i] = isFloor && caveVegetationMask(wx, wy, wz, worldSeed, cfg);
+          int i = blockIndex(x, y, z);
+          blocks[i] = 0; // carve to air
+          carved[i] = true;
         }
       }
     }
   }
+
+  if (!outVegetationMask)
+    return;
+
+  for (int z = 0; z < CHUNK_SIZE; ++z)
+  {
+    for (int x = 0; x < CHUNK_SIZE; ++x)
+    {
+      for (int y = 0; y + 1 < CHUNK_SIZE; ++y)
+      {
+        int i = blockIndex(x, y, z);
+        if (!carved[i] && carved[blockIndex(x, y + 1, z)])
+          outVegetationMask[i] = caveVegetationMask(baseX + x, baseY + y, baseZ + z, worldSeed, cfg);
+      }
+    }
+  }
 }
 
 void applyCavesToChunk(Chunk& c, uint32_t worldSeed, const int* terrainHeights, 
                        const CaveConfig& cfg, bool* outVegetationMask)
 {
-  applyCavesToBlocks(c.blocks, c.position, worldSeed, terrainHeights, cfg, outVegetationMask);
+  BlockID blocks[CHUNK_VOLUME];
+  c.blocks.decode(blocks);
+  applyCavesToBlocks(blocks, c.position, worldSeed, terrainHeights, cfg, outVegetationMask);
+  c.blocks.assign(blocks);
 }
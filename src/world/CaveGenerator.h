@@ -27,6 +27,10 @@ float caveDensity(int wx, int wy, int wz, int terrainHeight, uint32_t seed, cons
 
 bool caveVegetationMask(int wx, int wy, int wz, uint32_t seed, const CaveConfig& cfg = CaveConfig{});
 
+// Whether any voxel of section cy lies in the carvable height range of a
+// column whose highest surface is maxTerrainHeight.
+bool sectionMayHaveCaves(int cy, int maxTerrainHeight, const CaveConfig& cfg = CaveConfig{});
+
 void applyCavesToBlocks(BlockID* blocks, const glm::ivec3& chunkPos, uint32_t worldSeed, 
                         const int* terrainHeights, const CaveConfig& cfg = CaveConfig{}, 
                         bool* outVegetationMask = nullptr);
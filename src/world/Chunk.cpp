@@ -1,5 +1,7 @@
 #include "Chunk.h"
+#include "../utils/BlockTypes.h"
 #include <algorithm>
+#include <cstring>
 
 const glm::ivec3 DIRS[6] = {
     {1, 0, 0},
@@ -10,25 +12,204 @@ const glm::ivec3 DIRS[6] = {
     {0, 0, -1}
 };
 
+namespace
+{
+int bitsForPalette(size_t paletteSize)
+{
+  if (paletteSize <= 1)
+    return 0;
+  if (paletteSize <= 2)
+    return 1;
+  if (paletteSize <= 4)
+    return 2;
+  if (paletteSize <= 16)
+    return 4;
+  return 8;
+}
+
+template <int Bits>
+void unpackWords(const uint32_t* words, const uint8_t* palette, uint8_t* out, int count)
+{
+  constexpr int perWord = 32 / Bits;
+  constexpr uint32_t mask = (1u << Bits) - 1;
+  for (int w = 0; w < count / perWord; w++)
+  {
+    uint32_t word = words[w];
+    for (int k = 0; k < perWord; k++)
+      out[w * perWord + k] = palette[(word >> (k * Bits)) & mask];
+  }
+}
+}
+
+PaletteStorage::PaletteStorage(uint8_t value)
+    : palette(1, value)
+{
+}
+
+void PaletteStorage::set(int index, uint8_t value)
+{
+  auto it = std::find(palette.begin(), palette.end(), value);
+  uint32_t slot = static_cast<uint32_t>(it - palette.begin());
+  if (it == palette.end())
+  {
+    if (palette.size() >= (size_t(1) << bits))
+      repack(bitsForPalette(palette.size() + 1));
+    palette.push_back(value);
+  }
+
+  if (bits == 0)
+    return;
+
+  int bitPos = index * bits;
+  int shift = bitPos & 31;
+  uint32_t mask = ((1u << bits) - 1) << shift;
+  uint32_t& word = data[bitPos >> 5];
+  word = (word & ~mask) | (slot << shift);
+}
+
+void PaletteStorage::fill(uint8_t value)
+{
+  palette.assign(1, value);
+  palette.shrink_to_fit();
+  std::vector<uint32_t>().swap(data);
+  bits = 0;
+}
+
+void PaletteStorage::assign(const uint8_t* values)
+{
+  int16_t lookup[256];
+  std::fill(std::begin(lookup), std::end(lookup), -1);
+  palette.clear();
+  for (int i = 0; i < CHUNK_VOLUME; i++)
+  {
+    if (lookup[values[i]] < 0)
+    {
+      lookup[values[i]] = static_cast<int16_t>(palette.size());
+      palette.push_back(values[i]);
+    }
+  }
+  palette.shrink_to_fit();
+
+  bits = bitsForPalette(palette.size());
+  if (bits == 0)
+  {
+    std::vector<uint32_t>().swap(data);
+    return;
+  }
+
+  int perWord = 32 / bits;
+  std::vector<uint32_t> packed(CHUNK_VOLUME / perWord);
+  for (size_t w = 0; w < packed.size(); w++)
+  {
+    uint32_t word = 0;
+    const uint8_t* src = values + w * perWord;
+    for (int k = 0; k < perWord; k++)
+      word |= static_cast<uint32_t>(lookup[src[k]]) << (k * bits);
+    packed[w] = word;
+  }
+  data.swap(packed);
+}
+
+void PaletteStorage::decode(uint8_t* out) const
+{
+  decodeRange(0, CHUNK_VOLUME, out);
+}
+
+void PaletteStorage::decodeRange(int start, int count, uint8_t* out) const
+{
+  if (bits == 0)
+  {
+    std::memset(out, palette[0], count);
+    return;
+  }
+
+  if (((start * bits) & 31) != 0 || ((count * bits) & 31) != 0)
+  {
+    for (int i = 0; i < count; i++)
+      out[i] = get(start + i);
+    return;
+  }
+
+  const uint32_t* words = data.data() + ((start * bits) >> 5);
+  switch (bits)
+  {
+  case 1: unpackWords<1>(words, palette.data(), out, count); break;
+  case 2: unpackWords<2>(words, palette.data(), out, count); break;
+  case 4: unpackWords<4>(words, palette.data(), out, count); break;
+  default: unpackWords<8>(words, palette.data(), out, count); break;
+  }
+}
+
+size_t PaletteStorage::memoryUsage() const
+{
+  return sizeof(*this) + palette.capacity() + data.capacity() * sizeof(uint32_t);
+}
+
+void PaletteStorage::repack(int newBits)
+{
+  std::vector<uint32_t> packed(CHUNK_VOLUME * newBits / 32, 0);
+  for (int i = 0; i < CHUNK_VOLUME; i++)
+  {
+    uint32_t slot = 0;
+    if (bits != 0)
+    {
+      int bitPos = i * bits;
+      slot = (data[bitPos >> 5] >> (bitPos & 31)) & ((1u << bits) - 1);
+    }
+    int newPos = i * newBits;
+    packed[newPos >> 5] |= slot << (newPos & 31);
+  }
+  data.swap(packed);
+  bits = newBits;
+}
+
 Chunk::Chunk()
-    : position(0)
+    : position(0), blocks(0), light(packLight(MAX_SKY_LIGHT, 0))
 {
-  std::fill(std::begin(blocks), std::end(blocks), 0);
-  std::fill(std::begin(skyLight), std::end(skyLight), MAX_SKY_LIGHT);
 }
 
 Chunk::~Chunk()
+{
+  releaseMesh();
+}
+
+void Chunk::classifyContent()
+{
+  // Palette entries are a superset of the blocks present, so a stale entry
+  // can only make the result more conservative.
+  const std::vector<BlockID>& ids = blocks.entries();
+  bool allOpaque = true;
+  for (BlockID id : ids)
+  {
+    if (id == 0 || g_blockTypes[id].isLiquid || g_blockTypes[id].transparent)
+      allOpaque = false;
+  }
+
+  if (blocks.isUniform() && ids[0] == 0)
+    content = ChunkContent::Empty;
+  else if (allOpaque)
+    content = ChunkContent::Solid;
+  else
+    content = ChunkContent::Mixed;
+}
+
+size_t Chunk::memoryUsage() const
+{
+  return sizeof(*this) - sizeof(blocks) - sizeof(light) +
+         blocks.memoryUsage() + light.memoryUsage();
+}
+
+void Chunk::releaseMesh()
 {
   if (vao)
     glDeleteVertexArrays(1, &vao);
   if (vbo)
     glDeleteBuffers(1, &vbo);
-  if (ebo)
-    glDeleteBuffers(1, &ebo);
   if (waterVao)
     glDeleteVertexArrays(1, &waterVao);
   if (waterVbo)
     glDeleteBuffers(1, &waterVbo);
-  if (waterEbo)
-    glDeleteBuffers(1, &waterEbo);
+  vao = vbo = waterVao = waterVbo = 0;
+  indexCount = vertexCount = 0;
+  waterIndexCount = waterVertexCount = 0;
 }
@@ -1,38 +1,166 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include "Biome.h"
 
 using BlockID = uint8_t;
 constexpr int CHUNK_SIZE = 16;
 constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+// Sections per column. Streaming and column generation cover cy 0..15.
+constexpr int WORLD_HEIGHT_CHUNKS = 256 / CHUNK_SIZE;
 
 constexpr uint8_t MAX_SKY_LIGHT = 15;
+constexpr uint8_t MAX_BLOCK_LIGHT = 15;
+
+// Light is one byte per voxel: sky light in the low nibble and light from
+// emissive blocks in the high nibble.
+inline uint8_t packLight(uint8_t sky, uint8_t block) { return static_cast<uint8_t>(sky | (block << 4)); }
+inline uint8_t skyLightOf(uint8_t light) { return light & 15; }
+inline uint8_t blockLightOf(uint8_t light) { return light >> 4; }
+
+// CHUNK_VOLUME bytes stored as indices into a small palette. Indices are 0, 1,
+// 2, 4 or 8 bits wide so none straddles a 32-bit word, and a uniform array
+// keeps no index data at all. The palette only grows on set(); assign()
+// rebuilds it from scratch.
+class PaletteStorage
+{
+public:
+  explicit PaletteStorage(uint8_t value = 0);
+
+  uint8_t get(int index) const
+  {
+    if (bits == 0)
+      return palette[0];
+    int bitPos = index * bits;
+    return palette[(data[bitPos >> 5] >> (bitPos & 31)) & ((1u << bits) - 1)];
+  }
+
+  void set(int index, uint8_t value);
+  void fill(uint8_t value);
+  void assign(const uint8_t* values);
+  void decode(uint8_t* out) const;
+  void decodeRange(int start, int count, uint8_t* out) const;
+
+  bool isUniform() const { return bits == 0; }
+  const std::vector<uint8_t>& entries() const { return palette; }
+  size_t memoryUsage() const;
+
+private:
+  void repack(int newBits);
+
+  std::vector<uint8_t> palette;
+  std::vector<uint32_t> data;
+  int bits = 0;
+};
+
+// Empty chunks are all air and Solid chunks are all opaque blocks; neither has
+// faces of its own unless a neighbour exposes them.
+enum class ChunkContent : uint8_t
+{
+  Empty,
+  Solid,
+  Mixed
+};
 
 struct Chunk
 {
   Chunk();
   ~Chunk();
 
+  void classifyContent();
+  void releaseMesh();
+
   glm::ivec3 position;
-  BlockID blocks[CHUNK_VOLUME];
-  uint8_t skyLight[CHUNK_VOLUME];
+  PaletteStorage blocks;
+  PaletteStorage light;
 
   bool dirtyMesh = true;
   bool dirtyLight = true;
   bool dirtyData = false;
-  GLuint vao = 0, vbo = 0, ebo = 0;
+  bool queuedForMesh = false;
+  // Bumped by every markMeshDirty; a mesh job only clears dirtyMesh if no
+  // request came in after its snapshot was taken.
+  uint32_t meshRevision = 0;
+  ChunkContent content = ChunkContent::Mixed;
+
+  // Face neighbours in DIRS order, linked and unlinked by ChunkManager. Bit i
+  // of neighborMask is set while neighbors[i] is loaded.
+  Chunk* neighbors[6] = {};
+  uint8_t neighborMask = 0;
+  GLuint vao = 0, vbo = 0;
   uint32_t indexCount = 0;
   uint32_t vertexCount = 0;
 
-  GLuint waterVao = 0, waterVbo = 0, waterEbo = 0;
+  GLuint waterVao = 0, waterVbo = 0;
   uint32_t waterIndexCount = 0;
   uint32_t waterVertexCount = 0;
+
+  BlockID blockAt(int x, int y, int z) const;
+  uint8_t lightAt(int x, int y, int z) const;
+  uint8_t skyLightAt(int x, int y, int z) const { return skyLightOf(lightAt(x, y, z)); }
+  uint8_t blockLightAt(int x, int y, int z) const { return blockLightOf(lightAt(x, y, z)); }
+  size_t memoryUsage() const;
 };
 
 extern const glm::ivec3 DIRS[6];
 
+constexpr uint8_t ALL_NEIGHBORS = 0x3F;
+
+// DIRS lists each axis as a +/- pair, so the opposite face differs in bit 0.
+inline int oppositeDir(int dir) { return dir ^ 1; }
+
 inline int blockIndex(int x, int y, int z)
 {
   return x + CHUNK_SIZE * (y + CHUNK_SIZE * z);
 }
+
+// Light a voxel at level passes to a transparent target across DIRS[dir],
+// targetY being the target's y. Sky light falls straight down undimmed
+// through air and dims on every second layer of other transparent blocks;
+// all other steps cost one level.
+inline uint8_t passedLight(uint8_t level, int dir, BlockID target, int targetY, bool sky)
+{
+  if (sky && DIRS[dir].y < 0)
+    return (target != 0 && level > 1 && targetY % 2 == 0) ? level - 1 : level;
+  return level > 0 ? level - 1 : 0;
+}
+
+// Voxel (a, b) of the chunk face towards DIRS[dir], with a and b running over
+// the two other axes in x, y, z order.
+inline glm::ivec3 faceVoxel(int dir, int a, int b)
+{
+  const glm::ivec3& d = DIRS[dir];
+  if (d.x != 0)
+    return glm::ivec3(d.x > 0 ? CHUNK_SIZE - 1 : 0, a, b);
+  if (d.y != 0)
+    return glm::ivec3(a, d.y > 0 ? CHUNK_SIZE - 1 : 0, b);
+  return glm::ivec3(a, b, d.z > 0 ? CHUNK_SIZE - 1 : 0);
+}
+
+inline BlockID Chunk::blockAt(int x, int y, int z) const { return blocks.get(blockIndex(x, y, z)); }
+inline uint8_t Chunk::lightAt(int x, int y, int z) const { return light.get(blockIndex(x, y, z)); }
+
+constexpr int PADDED_CHUNK_SIZE = CHUNK_SIZE + 2;
+constexpr int PADDED_CHUNK_VOLUME = PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE * PADDED_CHUNK_SIZE;
+
+// A chunk plus a one-block border from its neighbours, addressed with local
+// coordinates in [-1, CHUNK_SIZE]. Missing neighbours read as air in full sky
+// light.
+struct PaddedChunkVolume
+{
+  BlockID blocks[PADDED_CHUNK_VOLUME];
+  uint8_t light[PADDED_CHUNK_VOLUME];
+  // Interior columns only, indexed z * CHUNK_SIZE + x; used for tinting.
+  BiomeID biomes[CHUNK_SIZE * CHUNK_SIZE];
+
+  static int index(int x, int y, int z)
+  {
+    return (x + 1) + PADDED_CHUNK_SIZE * ((y + 1) + PADDED_CHUNK_SIZE * (z + 1));
+  }
+
+  BlockID blockAt(int x, int y, int z) const { return blocks[index(x, y, z)]; }
+  uint8_t lightAt(int x, int y, int z) const { return light[index(x, y, z)]; }
+};
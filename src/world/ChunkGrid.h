@@ -0,0 +1,76 @@
+#pragma once
+#include "Chunk.h"
+#include <algorithm>
+#include <vector>
+
+// Toroidal lookup table over loaded chunks. Each chunk coordinate wraps into
+// one slot (sizes are powers of two, so wrapping is a mask), and a slot only
+// answers for the chunk whose position it holds. insert() refuses a chunk whose
+// slot is already taken; the caller keeps such chunks reachable some other way.
+class ChunkGrid
+{
+public:
+  void resize(int sizeXZ, int sizeY)
+  {
+    this->sizeXZ = roundUpPow2(sizeXZ);
+    this->sizeY = roundUpPow2(sizeY);
+    maskXZ = this->sizeXZ - 1;
+    maskY = this->sizeY - 1;
+    slots.assign(static_cast<size_t>(this->sizeXZ) * this->sizeXZ * this->sizeY, nullptr);
+  }
+
+  void clear() { std::fill(slots.begin(), slots.end(), nullptr); }
+  bool empty() const { return slots.empty(); }
+  int sizeHorizontal() const { return sizeXZ; }
+
+  Chunk* find(const glm::ivec3& coord) const
+  {
+    if (slots.empty())
+      return nullptr;
+    Chunk* c = slots[slotIndex(coord)];
+    return (c && c->position == coord) ? c : nullptr;
+  }
+
+  bool insert(Chunk* chunk)
+  {
+    if (slots.empty())
+      return false;
+    Chunk*& slot = slots[slotIndex(chunk->position)];
+    if (slot && slot != chunk)
+      return false;
+    slot = chunk;
+    return true;
+  }
+
+  bool erase(Chunk* chunk)
+  {
+    if (slots.empty())
+      return false;
+    Chunk*& slot = slots[slotIndex(chunk->position)];
+    if (slot != chunk)
+      return false;
+    slot = nullptr;
+    return true;
+  }
+
+private:
+  static int roundUpPow2(int n)
+  {
+    int size = 1;
+    while (size < n)
+      size <<= 1;
+    return size;
+  }
+
+  size_t slotIndex(const glm::ivec3& c) const
+  {
+    return static_cast<size_t>(c.x & maskXZ) +
+           static_cast<size_t>(sizeXZ) * ((c.z & maskXZ) + static_cast<size_t>(sizeXZ) * (c.y & maskY));
+  }
+
+  std::vector<Chunk*> slots;
+  int sizeXZ = 0;
+  int sizeY = 0;
+  int maskXZ = 0;
+  int maskY = 0;
+};
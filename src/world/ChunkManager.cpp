@@ -2,13 +2,18 @@
 #include "../utils/JobSystem.h"
 #include "RegionManager.h"
 #include "../rendering/Meshing.h"
+#include "../utils/BlockTypes.h"
 #include "TerrainGenerator.h"
 #include "CaveGenerator.h"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 
+ChunkManager::~ChunkManager() = default;
+
 bool ChunkManager::hasChunk(int cx, int cy, int cz)
 {
-  return chunks.find(ChunkCoord(cx, cy, cz)) != chunks.end();
+  return getChunk(cx, cy, cz) != nullptr;
 }
 
 bool ChunkManager::isLoading(int cx, int cy, int cz) const
@@ -16,6 +21,11 @@ bool ChunkManager::isLoading(int cx, int cy, int cz) const
   return loadingChunks.find(ChunkCoord(cx, cy, cz)) != loadingChunks.end();
 }
 
+bool ChunkManager::isLighting(int cx, int cy, int cz) const
+{
+  return lightingChunks.find(ChunkCoord(cx, cy, cz)) != lightingChunks.end();
+}
+
 bool ChunkManager::isMeshing(int cx, int cy, int cz) const
 {
   return meshingChunks.find(ChunkCoord(cx, cy, cz)) != meshingChunks.end();
@@ -28,55 +38,158 @@ bool ChunkManager::isSaving(int cx, int cy, int cz) const
 
 Chunk *ChunkManager::getChunk(int cx, int cy, int cz)
 {
-  auto it = chunks.find(ChunkCoord(cx, cy, cz));
+  ChunkCoord key(cx, cy, cz);
+  if (Chunk* c = grid.find(key))
+    return c;
+  if (gridOverflow == 0)
+    return nullptr;
+
+  auto it = chunks.find(key);
   if (it == chunks.end())
     return nullptr;
   return it->second.get();
 }
 
+Chunk* ChunkManager::insertChunk(const ChunkCoord& coord)
+{
+  auto [it, inserted] = chunks.emplace(coord, std::make_unique<Chunk>());
+  (void)inserted;
+  Chunk* c = it->second.get();
+  c->position = coord;
+  if (!grid.insert(c))
+    gridOverflow++;
+
+  for (int i = 0; i < 6; i++)
+  {
+    ChunkCoord n = coord + DIRS[i];
+    Chunk* neighbor = getChunk(n.x, n.y, n.z);
+    if (!neighbor)
+      continue;
+    c->neighbors[i] = neighbor;
+    c->neighborMask |= 1u << i;
+    neighbor->neighbors[oppositeDir(i)] = c;
+    neighbor->neighborMask |= 1u << oppositeDir(i);
+  }
+  markMeshDirty(c);
+  return c;
+}
+
+void ChunkManager::eraseChunk(ChunkMap::iterator it)
+{
+  Chunk* c = it->second.get();
+  for (int i = 0; i < 6; i++)
+  {
+    Chunk* neighbor = c->neighbors[i];
+    if (!neighbor)
+      continue;
+    neighbor->neighbors[oppositeDir(i)] = nullptr;
+    neighbor->neighborMask &= ~(1u << oppositeDir(i));
+  }
+
+  if (!grid.erase(c))
+    gridOverflow--;
+  chunks.erase(it);
+}
+
+void ChunkManager::clearChunks()
+{
+  chunks.clear();
+  grid.clear();
+  gridOverflow = 0;
+  clearColumnMaps();
+}
+
+void ChunkManager::rebuildGrid(int radius)
+{
+  gridRadius = radius;
+  // One column of slack on each side for chunks just past the unload radius.
+  grid.resize(2 * radius + 3, WORLD_HEIGHT_CHUNKS);
+  gridOverflow = 0;
+  for (auto& pair : chunks)
+  {
+    if (!grid.insert(pair.second.get()))
+      gridOverflow++;
+  }
+}
+
 Chunk *ChunkManager::loadChunk(int cx, int cy, int cz)
 {
   ChunkCoord key(cx, cy, cz);
   if (savingChunks.count(key) > 0)
     return nullptr;
 
-  if (hasChunk(cx, cy, cz))
-    return getChunk(cx, cy, cz);
-
-  auto [it, inserted] = chunks.emplace(key, std::make_unique<Chunk>());
-  (void)inserted;
-  Chunk *c = it->second.get();
-  c->position = {cx, cy, cz};
-
-  glGenVertexArrays(1, &c->vao);
-  glGenBuffers(1, &c->vbo);
-  glGenBuffers(1, &c->ebo);
+  if (!hasChunk(cx, cy, cz))
+    loadColumn(cx, cz, 1u << cy);
+  return getChunk(cx, cy, cz);
+}
 
-  bool loadedFromDisk = false;
-  if (regionManager)
+void ChunkManager::loadColumn(int cx, int cz, uint32_t sections)
+{
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
   {
-    loadedFromDisk = regionManager->loadChunkData(cx, cy, cz, c->blocks);
+    if (hasChunk(cx, cy, cz) || isSaving(cx, cy, cz))
+      sections &= ~(1u << cy);
   }
+  if (sections == 0)
+    return;
 
-  if (!loadedFromDisk)
+  columnBlocks.resize(static_cast<size_t>(WORLD_HEIGHT_CHUNKS) * CHUNK_VOLUME);
+  columnLight.resize(static_cast<size_t>(WORLD_HEIGHT_CHUNKS) * CHUNK_VOLUME);
+  uint32_t loadedFromDisk = 0;
+  uint32_t lightFromDisk = 0;
+  if (regionManager)
   {
-    generateTerrain(c->blocks, cx, cy, cz);
-    
-    int terrainHeights[CHUNK_SIZE * CHUNK_SIZE];
-    getTerrainHeightsForChunk(cx, cz, terrainHeights);
-    applyCavesToChunk(*c, DEFAULT_WORLD_SEED, terrainHeights);
+    loadedFromDisk = regionManager->loadColumnData(cx, cz, sections, columnBlocks.data(),
+                                                   columnLight.data(), &lightFromDisk);
   }
 
-  for (int i = 0; i < 6; i++)
+  ColumnTerrain terrain;
+  bool terrainReady = false;
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
   {
-    Chunk* neighbor = getChunk(cx + DIRS[i].x, cy + DIRS[i].y, cz + DIRS[i].z);
-    if (neighbor != nullptr)
+    uint32_t bit = 1u << cy;
+    if (!(sections & bit))
+      continue;
+
+    BlockID* blocks = &columnBlocks[static_cast<size_t>(cy) * CHUNK_VOLUME];
+    bool uniform = false;
+    BlockID uniformBlock = 0;
+    if (!(loadedFromDisk & bit))
     {
-      neighbor->dirtyMesh = true;
+      if (!terrainReady)
+      {
+        computeColumnTerrain(cx, cz, terrain);
+        terrainReady = true;
+      }
+      uniform = uniformSection(terrain, cy, uniformBlock);
+      if (!uniform)
+      {
+        generateTerrain(blocks, terrain, cy);
+        applyCavesToBlocks(blocks, ChunkCoord(cx, cy, cz), DEFAULT_WORLD_SEED, terrain.maps->heights);
+      }
     }
-  }
 
-  return c;
+    Chunk *c = insertChunk(ChunkCoord(cx, cy, cz));
+    if (uniform)
+      c->blocks.fill(uniformBlock);
+    else
+      c->blocks.assign(blocks);
+    c->classifyContent();
+    if (lightFromDisk & bit)
+    {
+      c->light.assign(&columnLight[static_cast<size_t>(cy) * CHUNK_VOLUME]);
+      c->dirtyLight = false;
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+      Chunk* neighbor = c->neighbors[i];
+      if (neighbor != nullptr)
+      {
+        markMeshDirty(neighbor);
+      }
+    }
+  }
 }
 
 void ChunkManager::unloadChunk(int cx, int cy, int cz)
@@ -88,32 +201,44 @@ void ChunkManager::unloadChunk(int cx, int cy, int cz)
   {
     if (regionManager && it->second->dirtyData)
     {
-      regionManager->saveChunkData(cx, cy, cz, it->second->blocks);
+      BlockID blocks[CHUNK_VOLUME];
+      it->second->blocks.decode(blocks);
+      uint8_t light[CHUNK_VOLUME];
+      bool saveLight = lightSettled(*it->second);
+      if (saveLight)
+        it->second->light.decode(light);
+      regionManager->saveChunkData(cx, cy, cz, blocks, saveLight ? light : nullptr);
     }
-    chunks.erase(it);
+    eraseChunk(it);
   }
 }
 
-void ChunkManager::enqueueLoadChunk(int cx, int cy, int cz)
+void ChunkManager::enqueueLoadColumn(int cx, int cz, uint32_t sections)
 {
   if (!jobSystem)
   {
-    loadChunk(cx, cy, cz);
+    loadColumn(cx, cz, sections);
     return;
   }
 
-  ChunkCoord key(cx, cy, cz);
-  if (hasChunk(cx, cy, cz) || loadingChunks.count(key) > 0 || savingChunks.count(key) > 0)
-    return;
-
-  loadingChunks.insert(key);
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+  {
+    uint32_t bit = 1u << cy;
+    if (!(sections & bit))
+      continue;
 
-  auto job = std::make_unique<GenerateChunkJob>();
-  job->cx = cx;
-  job->cy = cy;
-  job->cz = cz;
+    ChunkCoord key(cx, cy, cz);
+    if (hasChunk(cx, cy, cz) || loadingChunks.count(key) > 0 || savingChunks.count(key) > 0)
+      sections &= ~bit;
+    else
+      loadingChunks.insert(key);
+  }
+  if (sections == 0)
+    return;
 
-  jobSystem->enqueue(std::move(job));
+  PendingChunkJob pending{ChunkCoord(cx, 0, cz), PendingChunkJob::Kind::Generate, 0, sections};
+  pending.priority = jobPriority(pending);
+  pendingJobs.push_back(pending);
 }
 
 void ChunkManager::enqueueSaveAndUnload(int cx, int cy, int cz)
@@ -134,16 +259,19 @@ void ChunkManager::enqueueSaveAndUnload(int cx, int cy, int cz)
   {
     savingChunks.insert(key);
 
-    auto job = std::make_unique<SaveChunkJob>();
+    auto job = saveJobPool.acquire();
     job->cx = cx;
     job->cy = cy;
     job->cz = cz;
-    std::memcpy(job->blocks, chunk->blocks, CHUNK_VOLUME * sizeof(BlockID));
+    chunk->blocks.decode(job->blocks);
+    job->hasLight = lightSettled(*chunk);
+    if (job->hasLight)
+      chunk->light.decode(job->light);
 
     jobSystem->enqueueHighPriority(std::move(job));
   }
 
-  chunks.erase(key);
+  eraseChunk(chunks.find(key));
 }
 
 void ChunkManager::enqueueMeshChunk(int cx, int cy, int cz)
@@ -155,145 +283,563 @@ void ChunkManager::enqueueMeshChunk(int cx, int cy, int cz)
   if (meshingChunks.count(key) > 0)
     return;
 
-  Chunk* chunk = getChunk(cx, cy, cz);
-  if (!chunk)
+  if (!hasChunk(cx, cy, cz))
     return;
 
   meshingChunks.insert(key);
+  pendingJobs.push_back({key, PendingChunkJob::Kind::Mesh, streamingPriority(key), 0});
+}
+
+bool ChunkManager::isBuried(const Chunk& chunk)
+{
+  if (chunk.content != ChunkContent::Solid)
+    return false;
+
+  for (int i = 0; i < 6; i++)
+  {
+    // Nothing is ever seen from below the bottom of the world.
+    if (chunk.position.y + DIRS[i].y < 0)
+      continue;
+    Chunk* neighbor = chunk.neighbors[i];
+    if (!neighbor || neighbor->content != ChunkContent::Solid)
+      return false;
+  }
+  return true;
+}
+
+bool ChunkManager::skipHiddenMesh(Chunk* chunk)
+{
+  if (chunk->content != ChunkContent::Empty && !isBuried(*chunk))
+    return false;
+
+  chunk->releaseMesh();
+  chunk->dirtyMesh = false;
+  return true;
+}
+
+ChunkManager::ContentCounts ChunkManager::countChunkContent()
+{
+  ContentCounts counts;
+  for (auto& pair : chunks)
+  {
+    const Chunk& chunk = *pair.second;
+    if (chunk.content == ChunkContent::Empty)
+      counts.empty++;
+    else if (chunk.content == ChunkContent::Mixed)
+      counts.mixed++;
+    else if (isBuried(chunk))
+      counts.buried++;
+    else
+      counts.exposed++;
+  }
+  return counts;
+}
+
+size_t ChunkManager::chunkMemoryUsage() const
+{
+  size_t bytes = 0;
+  for (const auto& pair : chunks)
+    bytes += pair.second->memoryUsage();
+  return bytes;
+}
+
+void ChunkManager::markMeshDirty(Chunk* chunk)
+{
+  chunk->dirtyMesh = true;
+  chunk->meshRevision++;
+  if (chunk->queuedForMesh)
+    return;
+  chunk->queuedForMesh = true;
+  meshQueue.push_back(chunk->position);
+}
+
+// Queues a relight job. A chunk already queued or in flight only has its flag
+// set; onLightComplete requeues it if the flag is set again by then.
+void ChunkManager::markLightDirty(Chunk* chunk)
+{
+  chunk->dirtyLight = true;
+  if (!jobSystem || lightingChunks.count(chunk->position) > 0)
+    return;
+
+  lightingChunks.insert(chunk->position);
+  pendingJobs.push_back({chunk->position, PendingChunkJob::Kind::Light, streamingPriority(chunk->position), 0});
+}
+
+// Light can be saved with the blocks once nothing is left to change it: the
+// chunk has been lit and neither it nor a face neighbour has a relight queued.
+bool ChunkManager::lightSettled(const Chunk& chunk) const
+{
+  return !chunk.dirtyLight && !lightPending(chunk);
+}
+
+// Meshes sample the light of their face neighbours too, so they wait until
+// none of those has a relight outstanding.
+bool ChunkManager::lightPending(const Chunk& chunk) const
+{
+  if (lightingChunks.count(chunk.position) > 0)
+    return true;
+  for (int i = 0; i < 6; i++)
+  {
+    const Chunk* neighbor = chunk.neighbors[i];
+    if (neighbor && lightingChunks.count(neighbor->position) > 0)
+      return true;
+  }
+  return false;
+}
+
+// Whether light across face dir would raise any voxel of chunk, i.e. its light
+// predates that neighbour's current light.
+bool ChunkManager::needsLightFrom(const Chunk& chunk, int dir) const
+{
+  const Chunk* neighbor = chunk.neighbors[dir];
+  const glm::ivec3& d = DIRS[dir];
+  for (int a = 0; a < CHUNK_SIZE; a++)
+  {
+    for (int b = 0; b < CHUNK_SIZE; b++)
+    {
+      glm::ivec3 inside = faceVoxel(dir, a, b);
+      glm::ivec3 outside = inside + d - d * CHUNK_SIZE;
+
+      BlockID block = chunk.blockAt(inside.x, inside.y, inside.z);
+      if (!isBlockTransparent(block))
+        continue;
+
+      uint8_t inner = chunk.lightAt(inside.x, inside.y, inside.z);
+      uint8_t outer = neighbor->lightAt(outside.x, outside.y, outside.z);
+      int towardsChunk = oppositeDir(dir);
+      if (passedLight(skyLightOf(outer), towardsChunk, block, inside.y, true) > skyLightOf(inner) ||
+          passedLight(blockLightOf(outer), towardsChunk, block, inside.y, false) > blockLightOf(inner))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool ChunkManager::neighborLoading(const Chunk& chunk) const
+{
+  for (int i = 0; i < 6 && chunk.neighborMask != ALL_NEIGHBORS; i++)
+  {
+    if (chunk.neighborMask & (1u << i))
+      continue;
+    if (loadingChunks.count(chunk.position + DIRS[i]) > 0)
+      return true;
+  }
+  return false;
+}
+
+void ChunkManager::takeMeshCandidates(size_t maxCount, std::vector<Chunk*>& out)
+{
+  out.clear();
+  meshReady.clear();
+
+  size_t keep = 0;
+  for (size_t i = 0; i < meshQueue.size(); i++)
+  {
+    ChunkCoord coord = meshQueue[i];
+    Chunk* chunk = getChunk(coord.x, coord.y, coord.z);
+    // Entries left behind by an unload, or duplicates of one already taken.
+    if (!chunk || !chunk->queuedForMesh)
+      continue;
+
+    if (!chunk->dirtyMesh)
+    {
+      chunk->queuedForMesh = false;
+      continue;
+    }
+
+    if (isMeshing(coord.x, coord.y, coord.z) || neighborLoading(*chunk) || lightPending(*chunk))
+    {
+      meshQueue[keep++] = coord;
+      continue;
+    }
+
+    if (skipHiddenMesh(chunk))
+    {
+      chunk->queuedForMesh = false;
+      continue;
+    }
+
+    chunk->queuedForMesh = false;
+    meshReady.push_back({streamingPriority(coord), chunk});
+  }
+  meshQueue.resize(keep);
+
+  size_t count = std::min(maxCount, meshReady.size());
+  std::partial_sort(meshReady.begin(), meshReady.begin() + count, meshReady.end(),
+      [](const std::pair<int, Chunk*>& a, const std::pair<int, Chunk*>& b)
+      {
+        return a.first < b.first;
+      });
+  for (size_t i = 0; i < meshReady.size(); i++)
+  {
+    Chunk* chunk = meshReady[i].second;
+    if (i < count)
+    {
+      out.push_back(chunk);
+    }
+    else
+    {
+      chunk->queuedForMesh = true;
+      meshQueue.push_back(chunk->position);
+    }
+  }
+}
+
+void ChunkManager::updateStreaming(int loadRadius, bool async, int maxLoads)
+{
+  glm::ivec2 column(streamingCenter.x, streamingCenter.z);
+  if (column != streamedColumn || loadRadius != streamedLoadRadius ||
+      streamingRadius != streamedUnloadRadius)
+  {
+    streamedColumn = column;
+    streamedUnloadRadius = streamingRadius;
+    rebuildStreamingSets(loadRadius, async);
+  }
+
+  // Columns are dropped once every section is loaded or loading; ones with a
+  // section still being saved stay queued until the save finishes.
+  int issued = 0;
+  size_t keep = 0;
+  size_t i = 0;
+  for (; i < loadQueue.size(); i++)
+  {
+    if (async && issued >= maxLoads)
+      break;
+
+    glm::ivec2 column = loadQueue[i];
+    bool saving = false;
+    uint32_t sections = missingSections(column, saving);
+    if (saving)
+      loadQueue[keep++] = column;
+    if (sections == 0)
+      continue;
+
+    if (async)
+      enqueueLoadColumn(column.x, column.y, sections);
+    else
+      loadColumn(column.x, column.y, sections);
+    for (; sections; sections &= sections - 1)
+      issued++;
+  }
+  loadQueue.erase(loadQueue.begin() + keep, loadQueue.begin() + i);
+}
+
+uint32_t ChunkManager::missingSections(const glm::ivec2& column, bool& saving)
+{
+  uint32_t sections = 0;
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+  {
+    if (hasChunk(column.x, cy, column.y) || isLoading(column.x, cy, column.y))
+      continue;
+    if (isSaving(column.x, cy, column.y))
+      saving = true;
+    else
+      sections |= 1u << cy;
+  }
+  return sections;
+}
 
-  auto job = std::make_unique<MeshChunkJob>();
-  job->cx = cx;
-  job->cy = cy;
-  job->cz = cz;
-  std::memcpy(job->blocks, chunk->blocks, CHUNK_VOLUME * sizeof(BlockID));
+void ChunkManager::rebuildStreamingSets(int loadRadius, bool async)
+{
+  if (loadRadius != streamedLoadRadius)
+  {
+    loadOffsets.clear();
+    for (int dx = -loadRadius; dx <= loadRadius; dx++)
+    {
+      for (int dz = -loadRadius; dz <= loadRadius; dz++)
+      {
+        loadOffsets.push_back({dx, dz});
+      }
+    }
+    std::sort(loadOffsets.begin(), loadOffsets.end(),
+        [](const glm::ivec2& a, const glm::ivec2& b)
+        {
+          int da = a.x * a.x + a.y * a.y;
+          int db = b.x * b.x + b.y * b.y;
+          return da < db;
+        });
+    streamedLoadRadius = loadRadius;
+  }
 
-  Chunk* neighborPosX = getChunk(cx + 1, cy, cz);
-  Chunk* neighborNegX = getChunk(cx - 1, cy, cz);
-  Chunk* neighborPosY = getChunk(cx, cy + 1, cz);
-  Chunk* neighborNegY = getChunk(cx, cy - 1, cz);
-  Chunk* neighborPosZ = getChunk(cx, cy, cz + 1);
-  Chunk* neighborNegZ = getChunk(cx, cy, cz - 1);
+  loadQueue.clear();
+  for (const glm::ivec2& offset : loadOffsets)
+  {
+    glm::ivec2 column = streamedColumn + offset;
+    bool saving = false;
+    if (missingSections(column, saving) != 0 || saving)
+      loadQueue.push_back(column);
+  }
 
-  if (neighborPosX)
+  std::vector<ChunkCoord> toUnload;
+  for (auto& pair : chunks)
   {
-    job->hasNeighborPosX = true;
-    copyNeighborFace(job->neighborPosX, neighborPosX, 0);
+    if (!inStreamingRange(pair.first))
+      toUnload.push_back(pair.first);
   }
-  if (neighborNegX)
+  for (const ChunkCoord& coord : toUnload)
   {
-    job->hasNeighborNegX = true;
-    copyNeighborFace(job->neighborNegX, neighborNegX, 1);
+    if (async)
+      enqueueSaveAndUnload(coord.x, coord.y, coord.z);
+    else
+      unloadChunk(coord.x, coord.y, coord.z);
   }
-  if (neighborPosY)
+  if (streamingRadius >= 0)
+    evictColumnMapsOutside(streamingCenter.x, streamingCenter.z, streamingRadius);
+}
+
+void ChunkManager::setStreamingFocus(const ChunkCoord& center, int radius)
+{
+  streamingCenter = center;
+  streamingRadius = radius;
+  if (radius >= 0 && radius != gridRadius)
+    rebuildGrid(radius);
+}
+
+bool ChunkManager::inStreamingRange(const ChunkCoord& coord) const
+{
+  if (streamingRadius < 0)
+    return true;
+
+  return std::abs(coord.x - streamingCenter.x) <= streamingRadius &&
+         std::abs(coord.z - streamingCenter.z) <= streamingRadius;
+}
+
+int ChunkManager::streamingPriority(const ChunkCoord& coord) const
+{
+  if (streamingRadius < 0)
+    return 0;
+
+  ChunkCoord d = coord - streamingCenter;
+  return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+// Generate requests are scored by horizontal distance alone since they cover
+// every section of their column.
+int ChunkManager::jobPriority(const PendingChunkJob& pending) const
+{
+  if (pending.kind != PendingChunkJob::Kind::Generate)
+    return streamingPriority(pending.coord);
+  return streamingPriority(ChunkCoord(pending.coord.x, streamingCenter.y, pending.coord.z));
+}
+
+size_t ChunkManager::pendingJobCount() const
+{
+  return pendingJobs.size() + (jobSystem ? jobSystem->pendingJobCount() : 0);
+}
+
+void ChunkManager::dispatchPendingJobs()
+{
+  if (!jobSystem)
+    return;
+
+  // Jobs already handed to workers can only be flagged; the worker skips them
+  // and the completion handler drops the result.
+  for (Job* job : inFlightJobs)
   {
-    job->hasNeighborPosY = true;
-    copyNeighborFace(job->neighborPosY, neighborPosY, 2);
+    if (!inStreamingRange(ChunkCoord(job->cx, job->cy, job->cz)))
+      job->cancelled.store(true, std::memory_order_relaxed);
   }
-  if (neighborNegY)
+
+  size_t kept = 0;
+  for (size_t i = 0; i < pendingJobs.size(); i++)
   {
-    job->hasNeighborNegY = true;
-    copyNeighborFace(job->neighborNegY, neighborNegY, 3);
+    PendingChunkJob pending = pendingJobs[i];
+    bool keep = inStreamingRange(pending.coord);
+    if (keep && pending.kind != PendingChunkJob::Kind::Generate)
+      keep = hasChunk(pending.coord.x, pending.coord.y, pending.coord.z);
+
+    if (!keep)
+    {
+      if (pending.kind == PendingChunkJob::Kind::Mesh)
+      {
+        meshingChunks.erase(pending.coord);
+      }
+      else if (pending.kind == PendingChunkJob::Kind::Light)
+      {
+        lightingChunks.erase(pending.coord);
+      }
+      else
+      {
+        for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+        {
+          if (pending.sections & (1u << cy))
+            loadingChunks.erase(ChunkCoord(pending.coord.x, cy, pending.coord.z));
+        }
+      }
+      cancelledJobs++;
+      continue;
+    }
+
+    pending.priority = jobPriority(pending);
+    pendingJobs[kept++] = pending;
   }
-  if (neighborPosZ)
+  pendingJobs.resize(kept);
+
+  // Keep the worker queues shallow so newly scored requests overtake stale ones.
+  size_t maxQueued = (std::max)(static_cast<size_t>(8), jobSystem->workerCount() * 4);
+  size_t queued = jobSystem->pendingJobCount();
+  if (pendingJobs.empty() || queued >= maxQueued)
+    return;
+
+  size_t budget = (std::min)(maxQueued - queued, pendingJobs.size());
+  std::partial_sort(pendingJobs.begin(), pendingJobs.begin() + budget, pendingJobs.end(),
+      [](const PendingChunkJob& a, const PendingChunkJob& b)
+      {
+        return a.priority < b.priority;
+      });
+
+  for (size_t i = 0; i < budget; i++)
   {
-    job->hasNeighborPosZ = true;
-    copyNeighborFace(job->neighborPosZ, neighborPosZ, 4);
+    switch (pendingJobs[i].kind)
+    {
+      case PendingChunkJob::Kind::Generate:
+        dispatchGenerate(pendingJobs[i]);
+        break;
+      case PendingChunkJob::Kind::Light:
+        dispatchLight(pendingJobs[i].coord);
+        break;
+      case PendingChunkJob::Kind::Mesh:
+        dispatchMesh(pendingJobs[i].coord);
+        break;
+    }
   }
-  if (neighborNegZ)
+  pendingJobs.erase(pendingJobs.begin(), pendingJobs.begin() + budget);
+}
+
+void ChunkManager::forgetInFlight(Job* job)
+{
+  for (size_t i = 0; i < inFlightJobs.size(); i++)
   {
-    job->hasNeighborNegZ = true;
-    copyNeighborFace(job->neighborNegZ, neighborNegZ, 5);
+    if (inFlightJobs[i] == job)
+    {
+      inFlightJobs[i] = inFlightJobs.back();
+      inFlightJobs.pop_back();
+      return;
+    }
   }
+}
 
-  std::memcpy(job->skyLight, chunk->skyLight, CHUNK_VOLUME * sizeof(uint8_t));
+size_t ChunkManager::jobAllocationCount() const
+{
+  return generateJobPool.allocationCount() + lightJobPool.allocationCount() +
+         meshJobPool.allocationCount() + saveJobPool.allocationCount();
+}
+
+size_t ChunkManager::pooledJobCount() const
+{
+  return generateJobPool.freeCount() + lightJobPool.freeCount() +
+         meshJobPool.freeCount() + saveJobPool.freeCount();
+}
 
-  if (neighborPosX)
-    copyNeighborSkyLightFace(job->skyLightPosX, neighborPosX, 0);
-  if (neighborNegX)
-    copyNeighborSkyLightFace(job->skyLightNegX, neighborNegX, 1);
-  if (neighborPosY)
-    copyNeighborSkyLightFace(job->skyLightPosY, neighborPosY, 2);
-  if (neighborNegY)
-    copyNeighborSkyLightFace(job->skyLightNegY, neighborNegY, 3);
-  if (neighborPosZ)
-    copyNeighborSkyLightFace(job->skyLightPosZ, neighborPosZ, 4);
-  if (neighborNegZ)
-    copyNeighborSkyLightFace(job->skyLightNegZ, neighborNegZ, 5);
+void ChunkManager::dispatchGenerate(const PendingChunkJob& pending)
+{
+  auto job = generateJobPool.acquire();
+  job->cx = pending.coord.x;
+  job->cy = 0;
+  job->cz = pending.coord.z;
+  job->sections = pending.sections;
 
+  inFlightJobs.push_back(job.get());
   jobSystem->enqueue(std::move(job));
 }
 
-void ChunkManager::copyNeighborFace(BlockID* dest, Chunk* neighbor, int face)
+void ChunkManager::dispatchLight(const ChunkCoord& coord)
 {
-  switch (face)
+  // A synchronous relight may have beaten the job to it.
+  Chunk* chunk = getChunk(coord.x, coord.y, coord.z);
+  if (!chunk || !chunk->dirtyLight)
   {
-    case 0:
-      for (int y = 0; y < CHUNK_SIZE; y++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[y * CHUNK_SIZE + z] = neighbor->blocks[blockIndex(0, y, z)];
-      break;
-    case 1:
-      for (int y = 0; y < CHUNK_SIZE; y++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[y * CHUNK_SIZE + z] = neighbor->blocks[blockIndex(CHUNK_SIZE - 1, y, z)];
-      break;
-    case 2:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[x * CHUNK_SIZE + z] = neighbor->blocks[blockIndex(x, 0, z)];
-      break;
-    case 3:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[x * CHUNK_SIZE + z] = neighbor->blocks[blockIndex(x, CHUNK_SIZE - 1, z)];
-      break;
-    case 4:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int y = 0; y < CHUNK_SIZE; y++)
-          dest[x * CHUNK_SIZE + y] = neighbor->blocks[blockIndex(x, y, 0)];
-      break;
-    case 5:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int y = 0; y < CHUNK_SIZE; y++)
-          dest[x * CHUNK_SIZE + y] = neighbor->blocks[blockIndex(x, y, CHUNK_SIZE - 1)];
-      break;
+    lightingChunks.erase(coord);
+    return;
   }
+
+  auto job = lightJobPool.acquire();
+  job->cx = coord.x;
+  job->cy = coord.y;
+  job->cz = coord.z;
+  copyPaddedVolume(coord.x, coord.y, coord.z, job->volume);
+  job->neighborMask = chunk->neighborMask;
+  chunk->dirtyLight = false;
+
+  inFlightJobs.push_back(job.get());
+  jobSystem->enqueue(std::move(job));
+}
+
+void ChunkManager::dispatchMesh(const ChunkCoord& coord)
+{
+  Chunk* chunk = getChunk(coord.x, coord.y, coord.z);
+  if (!chunk)
+    return;
+
+  auto job = meshJobPool.acquire();
+  job->cx = coord.x;
+  job->cy = coord.y;
+  job->cz = coord.z;
+  copyPaddedVolume(coord.x, coord.y, coord.z, job->volume);
+  job->meshRevision = chunk->meshRevision;
+
+  inFlightJobs.push_back(job.get());
+  jobSystem->enqueue(std::move(job));
 }
 
-void ChunkManager::copyNeighborSkyLightFace(uint8_t* dest, Chunk* neighbor, int face)
+void ChunkManager::copyPaddedVolume(int cx, int cy, int cz, PaddedChunkVolume& out)
 {
-  switch (face)
+  std::shared_ptr<const ColumnMaps> maps = getColumnMaps(cx, cz);
+  std::copy(std::begin(maps->biomes), std::end(maps->biomes), out.biomes);
+
+  // Each padded row along x is one interior run plus a single block from the
+  // -x and +x neighbours, so the snapshot is a series of short row copies.
+  Chunk* neighbors[3][3][3];
+  for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+      for (int dx = -1; dx <= 1; dx++)
+        neighbors[dz + 1][dy + 1][dx + 1] = getChunk(cx + dx, cy + dy, cz + dz);
+
+  for (int z = -1; z <= CHUNK_SIZE; z++)
   {
-    case 0:
-      for (int y = 0; y < CHUNK_SIZE; y++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[y * CHUNK_SIZE + z] = neighbor->skyLight[blockIndex(0, y, z)];
-      break;
-    case 1:
-      for (int y = 0; y < CHUNK_SIZE; y++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[y * CHUNK_SIZE + z] = neighbor->skyLight[blockIndex(CHUNK_SIZE - 1, y, z)];
-      break;
-    case 2:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[x * CHUNK_SIZE + z] = neighbor->skyLight[blockIndex(x, 0, z)];
-      break;
-    case 3:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int z = 0; z < CHUNK_SIZE; z++)
-          dest[x * CHUNK_SIZE + z] = neighbor->skyLight[blockIndex(x, CHUNK_SIZE - 1, z)];
-      break;
-    case 4:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int y = 0; y < CHUNK_SIZE; y++)
-          dest[x * CHUNK_SIZE + y] = neighbor->skyLight[blockIndex(x, y, 0)];
-      break;
-    case 5:
-      for (int x = 0; x < CHUNK_SIZE; x++)
-        for (int y = 0; y < CHUNK_SIZE; y++)
-          dest[x * CHUNK_SIZE + y] = neighbor->skyLight[blockIndex(x, y, CHUNK_SIZE - 1)];
-      break;
+    int dz = (z < 0) ? -1 : (z >= CHUNK_SIZE ? 1 : 0);
+    int sz = z - dz * CHUNK_SIZE;
+
+    for (int y = -1; y <= CHUNK_SIZE; y++)
+    {
+      int dy = (y < 0) ? -1 : (y >= CHUNK_SIZE ? 1 : 0);
+      int sy = y - dy * CHUNK_SIZE;
+      Chunk** row = neighbors[dz + 1][dy + 1];
+      int dest = PaddedChunkVolume::index(-1, y, z);
+
+      if (row[0])
+      {
+        out.blocks[dest] = row[0]->blockAt(CHUNK_SIZE - 1, sy, sz);
+        out.light[dest] = row[0]->lightAt(CHUNK_SIZE - 1, sy, sz);
+      }
+      else
+      {
+        out.blocks[dest] = 0;
+        out.light[dest] = packLight(MAX_SKY_LIGHT, 0);
+      }
+
+      if (row[1])
+      {
+        row[1]->blocks.decodeRange(blockIndex(0, sy, sz), CHUNK_SIZE, &out.blocks[dest + 1]);
+        row[1]->light.decodeRange(blockIndex(0, sy, sz), CHUNK_SIZE, &out.light[dest + 1]);
+      }
+      else
+      {
+        std::memset(&out.blocks[dest + 1], 0, CHUNK_SIZE * sizeof(BlockID));
+        std::memset(&out.light[dest + 1], packLight(MAX_SKY_LIGHT, 0), CHUNK_SIZE * sizeof(uint8_t));
+      }
+
+      if (row[2])
+      {
+        out.blocks[dest + CHUNK_SIZE + 1] = row[2]->blockAt(0, sy, sz);
+        out.light[dest + CHUNK_SIZE + 1] = row[2]->lightAt(0, sy, sz);
+      }
+      else
+      {
+        out.blocks[dest + CHUNK_SIZE + 1] = 0;
+        out.light[dest + CHUNK_SIZE + 1] = packLight(MAX_SKY_LIGHT, 0);
+      }
+    }
   }
 }
 
@@ -302,65 +848,184 @@ void ChunkManager::update()
   if (!jobSystem)
     return;
 
-  auto completedGenerations = jobSystem->pollCompletedGenerations();
+  jobSystem->pollCompletedGenerations(completedGenerations);
   for (auto& job : completedGenerations)
   {
     onGenerateComplete(job.get());
+    generateJobPool.release(std::move(job));
+  }
+  completedGenerations.clear();
+
+  jobSystem->pollCompletedLights(completedLights);
+  for (auto& job : completedLights)
+  {
+    onLightComplete(job.get());
+    lightJobPool.release(std::move(job));
   }
+  completedLights.clear();
 
-  auto completedMeshes = jobSystem->pollCompletedMeshes();
+  jobSystem->pollCompletedMeshes(completedMeshes);
   for (auto& job : completedMeshes)
   {
     onMeshComplete(job.get());
+    meshJobPool.release(std::move(job));
   }
+  completedMeshes.clear();
 
-  auto completedSaves = jobSystem->pollCompletedSaves();
+  jobSystem->pollCompletedSaves(completedSaves);
   for (auto& job : completedSaves)
   {
     savingChunks.erase(ChunkCoord(job->cx, job->cy, job->cz));
+    saveJobPool.release(std::move(job));
   }
+  completedSaves.clear();
 }
 
-void ChunkManager::onGenerateComplete(GenerateChunkJob* job)
+void ChunkManager::onGenerateComplete(GenerateColumnJob* job)
 {
-  ChunkCoord key(job->cx, job->cy, job->cz);
-  loadingChunks.erase(key);
+  forgetInFlight(job);
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+  {
+    if (job->sections & (1u << cy))
+      loadingChunks.erase(ChunkCoord(job->cx, cy, job->cz));
+  }
 
-  if (hasChunk(job->cx, job->cy, job->cz))
+  if (job->cancelled.load(std::memory_order_relaxed))
+  {
+    cancelledJobs++;
+    // The focus came back while the job was in flight, so the rebuild skipped
+    // the column as loading; queue it again or it stays missing.
+    glm::ivec2 column(job->cx, job->cz);
+    glm::ivec2 d = column - streamedColumn;
+    if (std::abs(d.x) <= streamedLoadRadius && std::abs(d.y) <= streamedLoadRadius &&
+        std::find(loadQueue.begin(), loadQueue.end(), column) == loadQueue.end())
+      loadQueue.push_back(column);
     return;
+  }
 
-  auto [it, inserted] = chunks.emplace(key, std::make_unique<Chunk>());
-  Chunk* c = it->second.get();
-  c->position = {job->cx, job->cy, job->cz};
+  if (!inStreamingRange(ChunkCoord(job->cx, 0, job->cz)))
+  {
+    staleJobs++;
+    return;
+  }
 
-  std::memcpy(c->blocks, job->blocks, CHUNK_VOLUME * sizeof(BlockID));
-  std::memcpy(c->skyLight, job->skyLight, CHUNK_VOLUME * sizeof(uint8_t));
+  for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+  {
+    if (!(job->sections & (1u << cy)) || hasChunk(job->cx, cy, job->cz))
+      continue;
 
-  glGenVertexArrays(1, &c->vao);
-  glGenBuffers(1, &c->vbo);
-  glGenBuffers(1, &c->ebo);
+    Chunk* c = insertChunk(ChunkCoord(job->cx, cy, job->cz));
 
-  c->dirtyMesh = true;
+    if (job->uniform & (1u << cy))
+    {
+      c->blocks.fill(job->uniformBlocks[cy]);
+      c->light.fill(packLight(MAX_SKY_LIGHT, 0));
+    }
+    else
+    {
+      c->blocks.assign(job->blocks[cy]);
+      c->light.assign(job->light[cy]);
+    }
+    c->classifyContent();
+    c->dirtyLight = false;
+    if (!(job->skyLit & (1u << cy)))
+      markLightDirty(c);
 
-  for (int i = 0; i < 6; i++)
+    for (int i = 0; i < 6; i++)
+    {
+      Chunk* neighbor = c->neighbors[i];
+      if (neighbor == nullptr)
+        continue;
+
+      markMeshDirty(neighbor);
+      // A section below from an earlier load was lit without knowing what is above it.
+      bool litWithoutUs = i == DIR_NEG_Y && !(job->sections & (1u << (cy - 1)));
+      if (litWithoutUs || needsLightFrom(*neighbor, oppositeDir(i)))
+        markLightDirty(neighbor);
+      if (needsLightFrom(*c, i))
+        markLightDirty(c);
+    }
+  }
+}
+
+void ChunkManager::onLightComplete(LightChunkJob* job)
+{
+  ChunkCoord key(job->cx, job->cy, job->cz);
+  lightingChunks.erase(key);
+  forgetInFlight(job);
+
+  if (job->cancelled.load(std::memory_order_relaxed))
+  {
+    cancelledJobs++;
+    return;
+  }
+
+  Chunk* chunk = getChunk(job->cx, job->cy, job->cz);
+  if (!chunk)
   {
-    Chunk* neighbor = getChunk(job->cx + DIRS[i].x, job->cy + DIRS[i].y, job->cz + DIRS[i].z);
-    if (neighbor != nullptr)
+    staleJobs++;
+    return;
+  }
+
+  uint8_t oldLight[CHUNK_VOLUME];
+  chunk->light.decode(oldLight);
+  if (std::memcmp(oldLight, job->light, CHUNK_VOLUME) != 0)
+  {
+    chunk->light.assign(job->light);
+    markMeshDirty(chunk);
+
+    // Relighting carries on across every face whose light changed, until
+    // neighbours come back unchanged.
+    for (int i = 0; i < 6; i++)
     {
-      neighbor->dirtyMesh = true;
+      Chunk* neighbor = chunk->neighbors[i];
+      if (!neighbor)
+        continue;
+
+      bool changed = false;
+      for (int a = 0; a < CHUNK_SIZE && !changed; a++)
+      {
+        for (int b = 0; b < CHUNK_SIZE && !changed; b++)
+        {
+          glm::ivec3 p = faceVoxel(i, a, b);
+          int idx = blockIndex(p.x, p.y, p.z);
+          changed = oldLight[idx] != job->light[idx];
+        }
+      }
+      if (changed)
+      {
+        markMeshDirty(neighbor);
+        markLightDirty(neighbor);
+      }
     }
   }
+
+  if (chunk->dirtyLight)
+    markLightDirty(chunk);
 }
 
 void ChunkManager::onMeshComplete(MeshChunkJob* job)
 {
-  meshingChunks.erase(ChunkCoord(job->cx, job->cy, job->cz));
+  ChunkCoord key(job->cx, job->cy, job->cz);
+  meshingChunks.erase(key);
+  forgetInFlight(job);
+
+  if (job->cancelled.load(std::memory_order_relaxed))
+  {
+    cancelledJobs++;
+    return;
+  }
 
   Chunk* chunk = getChunk(job->cx, job->cy, job->cz);
   if (!chunk)
+  {
+    staleJobs++;
     return;
+  }
 
-  uploadToGPU(*chunk, job->vertices, job->indices);
-  uploadWaterToGPU(*chunk, job->waterVertices, job->waterIndices);
-  chunk->dirtyMesh = false;
+  uploadToGPU(*chunk, job->vertices);
+  uploadWaterToGPU(*chunk, job->waterVertices);
+  // Otherwise the chunk was marked again while meshing and is still queued.
+  if (chunk->meshRevision == job->meshRevision)
+    chunk->dirtyMesh = false;
 }
@@ -1,16 +1,23 @@
 #pragma once
 #include "Chunk.h"
+#include "ChunkGrid.h"
 #include "../utils/CoordUtils.h"
+#include "../utils/JobPool.h"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 class JobSystem;
 class RegionManager;
-struct GenerateChunkJob;
+struct Job;
+struct GenerateColumnJob;
+struct LightChunkJob;
 struct MeshChunkJob;
+struct SaveChunkJob;
 
 struct ChunkManager
 {
@@ -19,14 +26,51 @@ struct ChunkManager
   using ChunkMap = std::unordered_map<ChunkCoord, std::unique_ptr<Chunk>, ChunkCoordHash>;
   using ChunkSet = std::unordered_set<ChunkCoord, ChunkCoordHash>;
 
+  struct PendingChunkJob
+  {
+    enum class Kind : uint8_t
+    {
+      Generate,
+      Light,
+      Mesh
+    };
+
+    ChunkCoord coord;
+    Kind kind;
+    int priority;
+    // Generate requests cover a whole column; bit cy is set per section.
+    uint32_t sections;
+  };
+
+  struct ContentCounts
+  {
+    size_t empty = 0;
+    size_t buried = 0;
+    size_t exposed = 0;
+    size_t mixed = 0;
+  };
+
   ChunkMap chunks;
   ChunkSet loadingChunks;
+  ChunkSet lightingChunks;
   ChunkSet meshingChunks;
   ChunkSet savingChunks;
 
+  // Generate, light and mesh requests wait here until dispatch so they can be re-scored
+  // against the player position every frame and dropped once out of range.
+  std::vector<PendingChunkJob> pendingJobs;
+  std::vector<Job*> inFlightJobs;
+
+  ChunkCoord streamingCenter{0};
+  int streamingRadius = -1;
+  size_t cancelledJobs = 0;
+  size_t staleJobs = 0;
+
   JobSystem* jobSystem = nullptr;
   RegionManager* regionManager = nullptr;
 
+  ~ChunkManager();
+
   void setJobSystem(JobSystem* js) { jobSystem = js; }
   void setRegionManager(RegionManager* rm) { regionManager = rm; }
 
@@ -34,22 +78,88 @@ struct ChunkManager
   bool hasChunk(int cx, int cy, int cz);
 
   Chunk *loadChunk(int cx, int cy, int cz);
+  void loadColumn(int cx, int cz, uint32_t sections);
   void unloadChunk(int cx, int cy, int cz);
+  void clearChunks();
 
-  void enqueueLoadChunk(int cx, int cy, int cz);
+  void enqueueLoadColumn(int cx, int cz, uint32_t sections);
   void enqueueSaveAndUnload(int cx, int cy, int cz);
   void enqueueMeshChunk(int cx, int cy, int cz);
 
+  void setStreamingFocus(const ChunkCoord& center, int radius);
+  void updateStreaming(int loadRadius, bool async, int maxLoads);
+  void markMeshDirty(Chunk* chunk);
+  void markLightDirty(Chunk* chunk);
+  void takeMeshCandidates(size_t maxCount, std::vector<Chunk*>& out);
+  size_t streamingBacklog() const { return loadQueue.size(); }
+  size_t meshQueueSize() const { return meshQueue.size(); }
+  void dispatchPendingJobs();
+  size_t pendingJobCount() const;
+  void copyPaddedVolume(int cx, int cy, int cz, PaddedChunkVolume& out);
+  bool isBuried(const Chunk& chunk);
+  bool skipHiddenMesh(Chunk* chunk);
+  ContentCounts countChunkContent();
+  size_t chunkMemoryUsage() const;
+  size_t jobAllocationCount() const;
+  size_t pooledJobCount() const;
+
   bool isLoading(int cx, int cy, int cz) const;
+  bool isLighting(int cx, int cy, int cz) const;
   bool isMeshing(int cx, int cy, int cz) const;
   bool isSaving(int cx, int cy, int cz) const;
+  bool lightSettled(const Chunk& chunk) const;
 
   void update();
 
-  void onGenerateComplete(GenerateChunkJob* job);
+  void onGenerateComplete(GenerateColumnJob* job);
+  void onLightComplete(LightChunkJob* job);
   void onMeshComplete(MeshChunkJob* job);
 
 private:
-  void copyNeighborFace(BlockID* dest, Chunk* neighbor, int face);
-  void copyNeighborSkyLightFace(uint8_t* dest, Chunk* neighbor, int face);
+  bool inStreamingRange(const ChunkCoord& coord) const;
+  int streamingPriority(const ChunkCoord& coord) const;
+  int jobPriority(const PendingChunkJob& pending) const;
+  void dispatchGenerate(const PendingChunkJob& pending);
+  void dispatchLight(const ChunkCoord& coord);
+  void dispatchMesh(const ChunkCoord& coord);
+  void forgetInFlight(Job* job);
+  Chunk* insertChunk(const ChunkCoord& coord);
+  void eraseChunk(ChunkMap::iterator it);
+  void rebuildGrid(int radius);
+  void rebuildStreamingSets(int loadRadius, bool async);
+  uint32_t missingSections(const glm::ivec2& column, bool& saving);
+  bool neighborLoading(const Chunk& chunk) const;
+  bool lightPending(const Chunk& chunk) const;
+  bool needsLightFrom(const Chunk& chunk, int dir) const;
+
+  // Lookups go through the grid; the map owns the chunks and is only searched
+  // while some chunk is missing from the grid because its slot was taken.
+  ChunkGrid grid;
+  int gridRadius = -1;
+  size_t gridOverflow = 0;
+
+  // Columns still owed to the current focus, nearest first. Rebuilt only when
+  // the focus column or a radius changes.
+  std::vector<glm::ivec2> loadOffsets;
+  std::vector<glm::ivec2> loadQueue;
+  glm::ivec2 streamedColumn{0};
+  int streamedLoadRadius = -1;
+  int streamedUnloadRadius = -1;
+
+  // Chunks marked with markMeshDirty, waiting for their neighbours or for an
+  // in-flight mesh before they are handed out by takeMeshCandidates.
+  std::vector<ChunkCoord> meshQueue;
+  std::vector<std::pair<int, Chunk*>> meshReady;
+
+  JobPool<GenerateColumnJob> generateJobPool;
+  JobPool<LightChunkJob> lightJobPool;
+  JobPool<MeshChunkJob> meshJobPool;
+  JobPool<SaveChunkJob> saveJobPool;
+  std::vector<std::unique_ptr<GenerateColumnJob>> completedGenerations;
+  std::vector<std::unique_ptr<LightChunkJob>> completedLights;
+  std::vector<std::unique_ptr<MeshChunkJob>> completedMeshes;
+  std::vector<std::unique_ptr<SaveChunkJob>> completedSaves;
+  std::vector<BlockID> columnBlocks;
+  std::vector<uint8_t> columnLight;
+
 };
@@ -0,0 +1,212 @@
+#include "LightUpdate.h"
+#include "ChunkManager.h"
+#include "../rendering/Meshing.h"
+#include "../utils/BlockTypes.h"
+#include "../utils/CoordUtils.h"
+#include <algorithm>
+
+namespace
+{
+struct LightNode
+{
+  glm::ivec3 pos;
+  uint8_t level;
+};
+
+struct Voxel
+{
+  Chunk* chunk = nullptr;
+  int index = 0;
+};
+
+// Flood fill state for one channel. Voxels are addressed in world space and
+// resolved to their chunk on every access, so fills cross borders freely and
+// stop at unloaded chunks.
+class LightFill
+{
+public:
+  LightFill(ChunkManager& chunkManager, bool sky) : chunkManager(chunkManager), sky(sky) {}
+
+  void run(const glm::ivec3& origin)
+  {
+    Voxel voxel;
+    if (!locate(origin, voxel))
+      return;
+
+    uint8_t level = get(voxel);
+    set(voxel, sourceLevel(origin, voxel));
+    if (level > 0)
+      removeQueue.push_back({origin, level});
+    addQueue.push_back({origin, 0});
+
+    // The edited voxel may now let light through that was blocked before.
+    for (const glm::ivec3& dir : DIRS)
+      addQueue.push_back({origin + dir, 0});
+
+    removeLight();
+    addLight();
+  }
+
+  // Voxels written by the fills with their light byte before the edit.
+  std::vector<std::pair<Voxel, uint8_t>> touched;
+
+private:
+  bool locate(const glm::ivec3& pos, Voxel& out)
+  {
+    if (pos.y < 0 || pos.y >= WORLD_HEIGHT_CHUNKS * CHUNK_SIZE)
+      return false;
+
+    glm::ivec3 chunkPos = worldToChunk(pos.x, pos.y, pos.z);
+    if (!cached || cached->position != chunkPos)
+      cached = chunkManager.getChunk(chunkPos.x, chunkPos.y, chunkPos.z);
+    if (!cached)
+      return false;
+
+    glm::ivec3 local = worldToLocal(pos.x, pos.y, pos.z);
+    out.chunk = cached;
+    out.index = blockIndex(local.x, local.y, local.z);
+    return true;
+  }
+
+  uint8_t get(const Voxel& voxel) const
+  {
+    uint8_t light = voxel.chunk->light.get(voxel.index);
+    return sky ? skyLightOf(light) : blockLightOf(light);
+  }
+
+  void set(const Voxel& voxel, uint8_t level)
+  {
+    uint8_t light = voxel.chunk->light.get(voxel.index);
+    uint8_t updated = sky ? packLight(level, blockLightOf(light)) : packLight(skyLightOf(light), level);
+    if (updated == light)
+      return;
+    touched.push_back({voxel, light});
+    voxel.chunk->light.set(voxel.index, updated);
+  }
+
+  // Light a voxel has regardless of its neighbours: emission for block light,
+  // and for sky light the open sky above the top layer of the world. As in
+  // computeChunkLight, an unloaded section above lets no sky through; its
+  // arrival relights the sections below.
+  uint8_t sourceLevel(const glm::ivec3& pos, const Voxel& voxel)
+  {
+    BlockID block = voxel.chunk->blocks.get(voxel.index);
+    if (!sky)
+      return std::min(getBlockLightEmission(block), MAX_BLOCK_LIGHT);
+
+    if (!isBlockTransparent(block) || pos.y + 1 < WORLD_HEIGHT_CHUNKS * CHUNK_SIZE)
+      return 0;
+    return passedLight(MAX_SKY_LIGHT, DIR_NEG_Y, block, pos.y, true);
+  }
+
+  // Darkens every voxel whose light came through the removed one, queueing
+  // brighter voxels at the edge of the darkened region to refill it.
+  void removeLight()
+  {
+    for (size_t head = 0; head < removeQueue.size(); head++)
+    {
+      LightNode node = removeQueue[head];
+      for (int dir = 0; dir < 6; dir++)
+      {
+        glm::ivec3 pos = node.pos + DIRS[dir];
+        Voxel voxel;
+        if (!locate(pos, voxel))
+          continue;
+
+        uint8_t level = get(voxel);
+        if (level == 0)
+          continue;
+
+        BlockID block = voxel.chunk->blocks.get(voxel.index);
+        if (isBlockTransparent(block) && level <= passedLight(node.level, dir, block, pos.y, sky))
+        {
+          uint8_t source = sourceLevel(pos, voxel);
+          set(voxel, source);
+          removeQueue.push_back({pos, level});
+          if (source > 0)
+            addQueue.push_back({pos, 0});
+        }
+        else
+        {
+          addQueue.push_back({pos, 0});
+        }
+      }
+    }
+    removeQueue.clear();
+  }
+
+  void addLight()
+  {
+    for (size_t head = 0; head < addQueue.size(); head++)
+    {
+      glm::ivec3 pos = addQueue[head].pos;
+      Voxel voxel;
+      if (!locate(pos, voxel))
+        continue;
+
+      uint8_t level = get(voxel);
+      if (level == 0)
+        continue;
+
+      for (int dir = 0; dir < 6; dir++)
+      {
+        glm::ivec3 next = pos + DIRS[dir];
+        Voxel target;
+        if (!locate(next, target))
+          continue;
+
+        BlockID block = target.chunk->blocks.get(target.index);
+        if (!isBlockTransparent(block))
+          continue;
+
+        uint8_t passed = passedLight(level, dir, block, next.y, sky);
+        if (passed <= get(target))
+          continue;
+
+        set(target, passed);
+        addQueue.push_back({next, 0});
+      }
+    }
+    addQueue.clear();
+  }
+
+  ChunkManager& chunkManager;
+  bool sky;
+  Chunk* cached = nullptr;
+  std::vector<LightNode> removeQueue;
+  std::vector<LightNode> addQueue;
+};
+
+void addChanged(Chunk* chunk, std::vector<Chunk*>& changed)
+{
+  if (std::find(changed.begin(), changed.end(), chunk) == changed.end())
+    changed.push_back(chunk);
+}
+}
+
+void updateLightAfterEdit(ChunkManager& chunkManager, const glm::ivec3& worldPos, std::vector<Chunk*>& changed)
+{
+  for (bool sky : {true, false})
+  {
+    LightFill fill(chunkManager, sky);
+    fill.run(worldPos);
+
+    for (const auto& [voxel, before] : fill.touched)
+    {
+      if (voxel.chunk->light.get(voxel.index) == before)
+        continue;
+
+      addChanged(voxel.chunk, changed);
+      int x = voxel.index % CHUNK_SIZE;
+      int y = (voxel.index / CHUNK_SIZE) % CHUNK_SIZE;
+      int z = voxel.index / (CHUNK_SIZE * CHUNK_SIZE);
+      for (int dir = 0; dir < 6; dir++)
+      {
+        glm::ivec3 n = glm::ivec3(x, y, z) + DIRS[dir];
+        bool onFace = n.x < 0 || n.x >= CHUNK_SIZE || n.y < 0 || n.y >= CHUNK_SIZE || n.z < 0 || n.z >= CHUNK_SIZE;
+        if (onFace && voxel.chunk->neighbors[dir])
+          addChanged(voxel.chunk->neighbors[dir], changed);
+      }
+    }
+  }
+}
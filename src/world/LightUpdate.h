@@ -0,0 +1,13 @@
+#pragma once
+#include "Chunk.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+struct ChunkManager;
+
+// Brings sky and block light up to date after the block at worldPos changed;
+// the new block must already be stored. Removal and re-add flood fills start
+// at that voxel and cross chunk borders, so only light that depended on the
+// old block is touched. Every chunk whose mesh samples a changed light value,
+// including neighbours that read it as padding, is appended to changed once.
+void updateLightAfterEdit(ChunkManager& chunkManager, const glm::ivec3& worldPos, std::vector<Chunk*>& changed);
@@ -0,0 +1,205 @@
+#include "NoiseBatch.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOISE_BATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static bool scalarBlend = false;
+
+static inline float fade(float t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+static inline float lerp(float a, float b, float t) { return a + (b - a) * t; }
+
+static inline float grad(int32_t hash, float x, float y, float z)
+{
+    int h = hash & 15;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+static void blendScalar(const NoiseCells& cells, int begin, int end, float* out)
+{
+    for (int i = begin; i < end; i++)
+    {
+        float x = cells.fx[i];
+        float y = cells.fy[i];
+        float z = cells.fz[i];
+
+        float g000 = grad(cells.hashes[0][i], x, y, z);
+        float g100 = grad(cells.hashes[1][i], x - 1.0f, y, z);
+        float g010 = grad(cells.hashes[2][i], x, y - 1.0f, z);
+        float g110 = grad(cells.hashes[3][i], x - 1.0f, y - 1.0f, z);
+        float g001 = grad(cells.hashes[4][i], x, y, z - 1.0f);
+        float g101 = grad(cells.hashes[5][i], x - 1.0f, y, z - 1.0f);
+        float g011 = grad(cells.hashes[6][i], x, y - 1.0f, z - 1.0f);
+        float g111 = grad(cells.hashes[7][i], x - 1.0f, y - 1.0f, z - 1.0f);
+
+        float u = fade(x);
+        float v = fade(y);
+        float w = fade(z);
+
+        float front = lerp(lerp(g000, g100, u), lerp(g010, g110, u), v);
+        float back = lerp(lerp(g001, g101, u), lerp(g011, g111, u), v);
+        out[i] = lerp(front, back, w);
+    }
+}
+
+#ifdef NOISE_BATCH_SSE2
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 fadeSse(__m128 t)
+{
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))),
+                              _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerpSse(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+static inline __m128 gradSse(__m128i hash, __m128 x, __m128 y, __m128 z)
+{
+    __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+    __m128 below8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+    __m128 below4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    // h is 12 or 14 exactly when h | 2 == 14.
+    __m128 useX = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(14)));
+
+    __m128 u = select(below8, x, y);
+    __m128 v = select(below4, y, select(useX, x, z));
+    __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+    __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+}
+
+static inline __m128i loadHashes(const NoiseCells& cells, int corner, int i)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(&cells.hashes[corner][i]));
+}
+#endif
+
+void blendGradientNoise(const NoiseCells& cells, int count, float* out)
+{
+    int i = 0;
+#ifdef NOISE_BATCH_SSE2
+    if (scalarBlend)
+    {
+        blendScalar(cells, 0, count, out);
+        return;
+    }
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&cells.fx[i]);
+        __m128 y = _mm_loadu_ps(&cells.fy[i]);
+        __m128 z = _mm_loadu_ps(&cells.fz[i]);
+        __m128 x1 = _mm_sub_ps(x, one);
+        __m128 y1 = _mm_sub_ps(y, one);
+        __m128 z1 = _mm_sub_ps(z, one);
+
+        __m128 g000 = gradSse(loadHashes(cells, 0, i), x, y, z);
+        __m128 g100 = gradSse(loadHashes(cells, 1, i), x1, y, z);
+        __m128 g010 = gradSse(loadHashes(cells, 2, i), x, y1, z);
+        __m128 g110 = gradSse(loadHashes(cells, 3, i), x1, y1, z);
+        __m128 g001 = gradSse(loadHashes(cells, 4, i), x, y, z1);
+        __m128 g101 = gradSse(loadHashes(cells, 5, i), x1, y, z1);
+        __m128 g011 = gradSse(loadHashes(cells, 6, i), x, y1, z1);
+        __m128 g111 = gradSse(loadHashes(cells, 7, i), x1, y1, z1);
+
+        __m128 u = fadeSse(x);
+        __m128 v = fadeSse(y);
+        __m128 w = fadeSse(z);
+
+        __m128 front = lerpSse(lerpSse(g000, g100, u), lerpSse(g010, g110, u), v);
+        __m128 back = lerpSse(lerpSse(g001, g101, u), lerpSse(g011, g111, u), v);
+        _mm_storeu_ps(&out[i], lerpSse(front, back, w));
+    }
+#endif
+    blendScalar(cells, i, count, out);
+}
+
+void setScalarNoiseBlend(bool scalar)
+{
+    scalarBlend = scalar;
+}
+
+bool simdNoiseBlendAvailable()
+{
+#ifdef NOISE_BATCH_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+void octave2D01Batch(const siv::PerlinNoise& noise, const float* x, const float* z, int count,
+                     double frequency, int octaves, double persistence, float* out)
+{
+    const siv::PerlinNoise::state_type& perm = noise.serialize();
+    NoiseCells cells;
+    float layer[NOISE_BLOCK];
+    double sums[NOISE_BLOCK];
+
+    const double sampleZ = SIVPERLIN_DEFAULT_Z;
+    const int iz = static_cast<int>(std::floor(sampleZ)) & 255;
+    const float fz = static_cast<float>(sampleZ - std::floor(sampleZ));
+
+    for (int start = 0; start < count; start += NOISE_BLOCK)
+    {
+        int n = (std::min)(NOISE_BLOCK, count - start);
+        double octaveFrequency = frequency;
+        double amplitude = 1.0;
+        std::fill(sums, sums + n, 0.0);
+
+        for (int octave = 0; octave < octaves; octave++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                double px = x[start + i] * octaveFrequency;
+                double py = z[start + i] * octaveFrequency;
+                double floorX = std::floor(px);
+                double floorY = std::floor(py);
+                int ix = static_cast<int>(floorX) & 255;
+                int iy = static_cast<int>(floorY) & 255;
+
+                int a = (perm[ix] + iy) & 255;
+                int b = (perm[(ix + 1) & 255] + iy) & 255;
+                int aa = (perm[a] + iz) & 255;
+                int ab = (perm[(a + 1) & 255] + iz) & 255;
+                int ba = (perm[b] + iz) & 255;
+                int bb = (perm[(b + 1) & 255] + iz) & 255;
+
+                cells.hashes[0][i] = perm[aa];
+                cells.hashes[1][i] = perm[ba];
+                cells.hashes[2][i] = perm[ab];
+                cells.hashes[3][i] = perm[bb];
+                cells.hashes[4][i] = perm[(aa + 1) & 255];
+                cells.hashes[5][i] = perm[(ba + 1) & 255];
+                cells.hashes[6][i] = perm[(ab + 1) & 255];
+                cells.hashes[7][i] = perm[(bb + 1) & 255];
+                cells.fx[i] = static_cast<float>(px - floorX);
+                cells.fy[i] = static_cast<float>(py - floorY);
+                cells.fz[i] = fz;
+            }
+
+            blendGradientNoise(cells, n, layer);
+            for (int i = 0; i < n; i++)
+                sums[i] += layer[i] * amplitude;
+
+            octaveFrequency *= 2.0;
+            amplitude *= persistence;
+        }
+
+        for (int i = 0; i < n; i++)
+            out[start + i] = static_cast<float>(std::clamp(sums[i] * 0.5 + 0.5, 0.0, 1.0));
+    }
+}
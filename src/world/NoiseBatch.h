@@ -0,0 +1,36 @@
+#pragma once
+#include "../thirdparty/PerlinNoise.hpp"
+#include <cstdint>
+
+// Points handled per blendGradientNoise call. Batched callers split longer
+// runs into blocks of this size.
+constexpr int NOISE_BLOCK = 64;
+
+// Lattice cells of up to NOISE_BLOCK points, filled by a noise's own hashing
+// step. Corner hashes are stored per corner in the order 000, 100, 010, 110,
+// 001, 101, 011, 111 (x fastest); fx/fy/fz are the offsets inside the cell.
+struct NoiseCells
+{
+    int32_t hashes[8][NOISE_BLOCK];
+    float fx[NOISE_BLOCK];
+    float fy[NOISE_BLOCK];
+    float fz[NOISE_BLOCK];
+};
+
+// Improved-Perlin gradient blend for count points. Uses SSE2 four points at a
+// time where available and the scalar path for the tail and other targets;
+// both match the scalar Perlin evaluators to float precision.
+void blendGradientNoise(const NoiseCells& cells, int count, float* out);
+
+// Makes blendGradientNoise take the scalar path for every point, so tools can
+// check and time both kernels on one build. Must not be switched while
+// workers generate.
+void setScalarNoiseBlend(bool scalar);
+// Whether blendGradientNoise has a SIMD path on this target.
+bool simdNoiseBlendAvailable();
+
+// noise.octave2D_01(x[i] * frequency, z[i] * frequency, octaves, persistence)
+// for count points. Cells are hashed in double precision like
+// siv::PerlinNoise and blended in batches by blendGradientNoise.
+void octave2D01Batch(const siv::PerlinNoise& noise, const float* x, const float* z, int count,
+                     double frequency, int octaves, double persistence, float* out);
@@ -0,0 +1,165 @@
+#pragma once
+#include "NoiseBatch.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Seeded improved-Perlin noise for the cave fields. noise and fbm evaluate one
+// point; noiseBatch and fbmBatch hash cells here and blend them with
+// blendGradientNoise.
+class Perlin3D
+{
+public:
+  Perlin3D() = default;
+  explicit Perlin3D(uint32_t seed) { reseed(seed); }
+
+  void reseed(uint32_t seed)
+  {
+    uint32_t x = seed;
+    for (int i = 0; i < 256; ++i)
+    {
+      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+      perm[i] = static_cast<uint8_t>(x & 255u);
+    }
+    // fisher-yates shuffle
+    for (int i = 255; i > 0; --i)
+    {
+      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+      uint32_t j = x % static_cast<uint32_t>(i + 1);
+      std::swap(perm[i], perm[j]);
+    }
+    for (int i = 0; i < 256; ++i)
+      perm[256 + i] = perm[i];
+  }
+
+  float noise(float x, float y, float z) const
+  {
+    int X = static_cast<int>(std::floor(x)) & 255;
+    int Y = static_cast<int>(std::floor(y)) & 255;
+    int Z = static_cast<int>(std::floor(z)) & 255;
+
+    x -= std::floor(x);
+    y -= std::floor(y);
+    z -= std::floor(z);
+
+    float u = fade(x);
+    float v = fade(y);
+    float w = fade(z);
+
+    int A  = perm[X] + Y;
+    int AA = perm[A] + Z;
+    int AB = perm[A + 1] + Z;
+    int B  = perm[X + 1] + Y;
+    int BA = perm[B] + Z;
+    int BB = perm[B + 1] + Z;
+
+    float g000 = grad(perm[AA],     x,     y,     z    );
+    float g100 = grad(perm[BA],     x-1.0f,y,     z    );
+    float g010 = grad(perm[AB],     x,     y-1.0f,z    );
+    float g110 = grad(perm[BB],     x-1.0f,y-1.0f,z    );
+    float g001 = grad(perm[AA+1],   x,     y,     z-1.0f);
+    float g101 = grad(perm[BA+1],   x-1.0f,y,     z-1.0f);
+    float g011 = grad(perm[AB+1],   x,     y-1.0f,z-1.0f);
+    float g111 = grad(perm[BB+1],   x-1.0f,y-1.0f,z-1.0f);
+
+    float lerpX1 = lerp(u, g000, g100);
+    float lerpX2 = lerp(u, g010, g110);
+    float lerpX3 = lerp(u, g001, g101);
+    float lerpX4 = lerp(u, g011, g111);
+
+    float lerpY1 = lerp(v, lerpX1, lerpX2);
+    float lerpY2 = lerp(v, lerpX3, lerpX4);
+
+    return lerp(w, lerpY1, lerpY2); // ~[-1,1]
+  }
+
+  float fbm(float x, float y, float z, int octaves, float gain, float freq) const
+  {
+    float amp = 1.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < octaves; ++i)
+    {
+      sum += amp * noise(x * freq, y * freq, z * freq);
+      freq *= 2.0f;
+      amp *= gain;
+    }
+    return sum;
+  }
+
+  // noise(xs[i] * freq, ys[i] * freq, zs[i] * freq) for count points.
+  void noiseBatch(const float* xs, const float* ys, const float* zs, int count, float freq, float* out) const
+  {
+    NoiseCells cells;
+    for (int start = 0; start < count; start += NOISE_BLOCK)
+    {
+      int n = std::min(NOISE_BLOCK, count - start);
+      for (int i = 0; i < n; ++i)
+      {
+        float x = xs[start + i] * freq;
+        float y = ys[start + i] * freq;
+        float z = zs[start + i] * freq;
+        float floorX = std::floor(x);
+        float floorY = std::floor(y);
+        float floorZ = std::floor(z);
+        int X = static_cast<int>(floorX) & 255;
+        int Y = static_cast<int>(floorY) & 255;
+        int Z = static_cast<int>(floorZ) & 255;
+
+        int A  = perm[X] + Y;
+        int AA = perm[A] + Z;
+        int AB = perm[A + 1] + Z;
+        int B  = perm[X + 1] + Y;
+        int BA = perm[B] + Z;
+        int BB = perm[B + 1] + Z;
+
+        cells.hashes[0][i] = perm[AA];
+        cells.hashes[1][i] = perm[BA];
+        cells.hashes[2][i] = perm[AB];
+        cells.hashes[3][i] = perm[BB];
+        cells.hashes[4][i] = perm[AA + 1];
+        cells.hashes[5][i] = perm[BA + 1];
+        cells.hashes[6][i] = perm[AB + 1];
+        cells.hashes[7][i] = perm[BB + 1];
+        cells.fx[i] = x - floorX;
+        cells.fy[i] = y - floorY;
+        cells.fz[i] = z - floorZ;
+      }
+      blendGradientNoise(cells, n, out + start);
+    }
+  }
+
+  void fbmBatch(const float* xs, const float* ys, const float* zs, int count,
+                int octaves, float gain, float freq, float* out) const
+  {
+    float octave[NOISE_BLOCK];
+    for (int start = 0; start < count; start += NOISE_BLOCK)
+    {
+      int n = std::min(NOISE_BLOCK, count - start);
+      float amp = 1.0f;
+      float octaveFreq = freq;
+      std::fill(out + start, out + start + n, 0.0f);
+      for (int o = 0; o < octaves; ++o)
+      {
+        noiseBatch(xs + start, ys + start, zs + start, n, octaveFreq, octave);
+        for (int i = 0; i < n; ++i)
+          out[start + i] += amp * octave[i];
+        octaveFreq *= 2.0f;
+        amp *= gain;
+      }
+    }
+  }
+
+private:
+  std::array<uint8_t, 512> perm{};
+
+  static inline float fade(float t) { return t*t*t*(t*(t*6.0f-15.0f)+10.0f); }
+  static inline float lerp(float t, float a, float b) { return a + t * (b - a); }
+  static inline float grad(uint8_t h, float x, float y, float z)
+  {
+    int g = h & 15;
+    float u = g < 8 ? x : y;
+    float v = g < 4 ? y : (g == 12 || g == 14 ? x : z);
+    return ((g & 1) ? -u : u) + ((g & 2) ? -v : v);
+  }
+};
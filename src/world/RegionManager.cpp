@@ -162,6 +162,16 @@ bool compressPalette(const BlockID* blocks, std::vector<uint8_t>& out)
     return true;
 }
 
+// Compaction only runs once at least this many sectors, and at least 1/DIV
+// of the file, hold no live column.
+constexpr uint64_t COMPACT_MIN_DEAD_SECTORS = 64;
+constexpr uint64_t COMPACT_DEAD_RATIO_DIV = 4;
+
+uint32_t sectorCount(uint32_t numBytes)
+{
+    return (numBytes + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
 bool decompressPalette(const std::vector<uint8_t>& compressed, BlockID* outBlocks)
 {
     if (compressed.size() < 2) return false;
@@ -230,6 +240,8 @@ RegionFile::RegionFile(const std::string& path)
             writeHeader();
         }
     }
+
+    buildSectorMap();
 }
 
 RegionFile::~RegionFile()
@@ -260,18 +272,62 @@ void RegionFile::writeHeader()
     headerDirty = false;
 }
 
+// Persists one header entry. Sectors a column leaves are only freed after
+// this, so the header on disk never points into reused space.
+void RegionFile::writeHeaderEntry(int idx)
+{
+    file.seekp(static_cast<std::streamoff>(idx) * sizeof(ColumnEntry), std::ios::beg);
+    file.write(reinterpret_cast<const char*>(&header[idx]), sizeof(ColumnEntry));
+    file.flush();
+}
+
+void RegionFile::buildSectorMap()
+{
+    usedSectors.assign(HEADER_SECTORS, true);
+    for (const ColumnEntry& entry : header)
+    {
+        if (entry.offset < HEADER_SIZE || entry.size == 0)
+            continue;
+        setSectors(entry.offset / SECTOR_SIZE, sectorCount(entry.size), true);
+    }
+}
+
+void RegionFile::setSectors(uint32_t first, uint32_t count, bool used)
+{
+    if (first + count > usedSectors.size())
+        usedSectors.resize(first + count, false);
+    std::fill(usedSectors.begin() + first, usedSectors.begin() + first + count, used);
+}
+
+// Lowest run of count free sectors that ends before limit, or 0 if there is
+// none. Sector 0 always belongs to the header, so 0 never names a free run.
+uint32_t RegionFile::findFreeRun(uint32_t count, uint32_t limit) const
+{
+    limit = std::min(limit, static_cast<uint32_t>(usedSectors.size()));
+    uint32_t run = 0;
+    for (uint32_t sector = HEADER_SECTORS; sector < limit; sector++)
+    {
+        run = usedSectors[sector] ? 0 : run + 1;
+        if (run == count)
+            return sector + 1 - count;
+    }
+    return 0;
+}
+
+// First fit over the free sectors; without a large enough gap the column goes
+// at the end, starting inside any free run the file already ends with.
 uint32_t RegionFile::allocateSectors(uint32_t numBytes)
 {
-    file.seekg(0, std::ios::end);
-    uint32_t endPos = static_cast<uint32_t>(file.tellg());
-    
-    if (endPos < HEADER_SIZE)
+    uint32_t count = sectorCount(numBytes);
+    uint32_t first = findFreeRun(count, static_cast<uint32_t>(usedSectors.size()));
+    if (first == 0)
     {
-        endPos = HEADER_SIZE;
+        first = static_cast<uint32_t>(usedSectors.size());
+        while (first > HEADER_SECTORS && !usedSectors[first - 1])
+            first--;
     }
-    
-    uint32_t alignedEnd = ((endPos + SECTOR_SIZE - 1) / SECTOR_SIZE) * SECTOR_SIZE;
-    return alignedEnd;
+    setSectors(first, count, true);
+    return first * SECTOR_SIZE;
 }
 
 bool RegionFile::loadColumn(int localX, int localZ, ColumnData& outData)
@@ -292,6 +348,15 @@ bool RegionFile::loadColumn(int localX, int localZ, ColumnData& outData)
     uint8_t numSections = 0;
     file.read(reinterpret_cast<char*>(&numSections), 1);
 
+    uint8_t version = 0;
+    if (numSections & COLUMN_VERSION_FLAG)
+    {
+        version = numSections & ~COLUMN_VERSION_FLAG;
+        if (version > COLUMN_FORMAT_VERSION)
+            return false;
+        file.read(reinterpret_cast<char*>(&numSections), 1);
+    }
+
     outData.sections.clear();
     outData.sections.reserve(numSections);
 
@@ -306,6 +371,14 @@ bool RegionFile::loadColumn(int localX, int localZ, ColumnData& outData)
         section.compressedBlocks.resize(compressedSize);
         file.read(reinterpret_cast<char*>(section.compressedBlocks.data()), compressedSize);
 
+        if (version >= 1)
+        {
+            uint32_t lightSize = 0;
+            file.read(reinterpret_cast<char*>(&lightSize), 4);
+            section.compressedLight.resize(lightSize);
+            file.read(reinterpret_cast<char*>(section.compressedLight.data()), lightSize);
+        }
+
         outData.sections.push_back(std::move(section));
     }
 
@@ -319,25 +392,38 @@ void RegionFile::saveColumn(int localX, int localZ, const ColumnData& data)
     if (!file.is_open())
         return;
 
-    uint32_t totalSize = 1;
+    uint32_t totalSize = 2;
     for (const auto& section : data.sections)
     {
         totalSize += 1 + 4 + static_cast<uint32_t>(section.compressedBlocks.size());
+        totalSize += 4 + static_cast<uint32_t>(section.compressedLight.size());
     }
 
     int idx = getEntryIndex(localX, localZ);
+    uint32_t oldOffset = header[idx].offset;
     uint32_t offset = 0;
-    if (header[idx].offset != 0 && header[idx].size >= totalSize)
+    uint32_t needed = sectorCount(totalSize);
+    uint32_t held = oldOffset != 0 ? sectorCount(header[idx].size) : 0;
+    uint32_t freeFirst = 0;
+    uint32_t freeCount = 0;
+    if (held >= needed)
     {
-        offset = header[idx].offset;
+        offset = oldOffset;
+        freeFirst = offset / SECTOR_SIZE + needed;
+        freeCount = held - needed;
     }
     else
     {
+        freeFirst = oldOffset / SECTOR_SIZE;
+        freeCount = held;
         offset = allocateSectors(totalSize);
     }
 
     file.seekp(offset, std::ios::beg);
 
+    uint8_t version = COLUMN_VERSION_FLAG | COLUMN_FORMAT_VERSION;
+    file.write(reinterpret_cast<const char*>(&version), 1);
+
     uint8_t numSections = static_cast<uint8_t>(data.sections.size());
     file.write(reinterpret_cast<const char*>(&numSections), 1);
 
@@ -349,14 +435,26 @@ void RegionFile::saveColumn(int localX, int localZ, const ColumnData& data)
         file.write(reinterpret_cast<const char*>(&compressedSize), 4);
 
         file.write(reinterpret_cast<const char*>(section.compressedBlocks.data()), compressedSize);
-    }
 
-    header[idx].offset = offset;
-    header[idx].size = totalSize;
-    headerDirty = true;
+        uint32_t lightSize = static_cast<uint32_t>(section.compressedLight.size());
+        file.write(reinterpret_cast<const char*>(&lightSize), 4);
+        file.write(reinterpret_cast<const char*>(section.compressedLight.data()), lightSize);
+    }
 
     // Ensure written column data is visible to readers immediately
     file.flush();
+
+    header[idx].offset = offset;
+    header[idx].size = totalSize;
+    if (offset != oldOffset || freeCount > 0)
+    {
+        writeHeaderEntry(idx);
+        setSectors(freeFirst, freeCount, false);
+    }
+    else
+    {
+        headerDirty = true;
+    }
 }
 
 void RegionFile::flush()
@@ -368,6 +466,75 @@ void RegionFile::flush()
     }
 }
 
+// Moves columns down into the lowest free run below them, in file order, and
+// cuts the file off after the last one. Each move persists its header entry
+// before the old sectors are freed, so a crash mid-way leaves a valid file.
+// Files with little dead space are left alone. Safe while the file is in use.
+void RegionFile::compact()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.is_open())
+        return;
+
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    uint64_t fileSectors = (fileSize + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    uint64_t liveSectors = std::count(usedSectors.begin(), usedSectors.end(), true);
+    uint64_t deadSectors = fileSectors > liveSectors ? fileSectors - liveSectors : 0;
+    if (deadSectors < COMPACT_MIN_DEAD_SECTORS ||
+        deadSectors * COMPACT_DEAD_RATIO_DIV < fileSectors)
+        return;
+
+    std::vector<int> columns;
+    for (int i = 0; i < HEADER_ENTRIES; i++)
+    {
+        if (header[i].offset >= HEADER_SIZE && header[i].size != 0)
+            columns.push_back(i);
+    }
+    std::sort(columns.begin(), columns.end(),
+        [this](int a, int b) { return header[a].offset < header[b].offset; });
+
+    std::vector<char> buffer;
+    for (int idx : columns)
+    {
+        ColumnEntry& entry = header[idx];
+        uint32_t first = entry.offset / SECTOR_SIZE;
+        uint32_t count = sectorCount(entry.size);
+        uint32_t target = findFreeRun(count, first);
+        if (target == 0)
+            continue;
+
+        buffer.resize(entry.size);
+        file.seekg(entry.offset, std::ios::beg);
+        file.read(buffer.data(), entry.size);
+        file.seekp(static_cast<std::streamoff>(target) * SECTOR_SIZE, std::ios::beg);
+        file.write(buffer.data(), entry.size);
+        file.flush();
+
+        setSectors(target, count, true);
+        entry.offset = target * SECTOR_SIZE;
+        writeHeaderEntry(idx);
+        setSectors(first, count, false);
+    }
+
+    if (headerDirty)
+        writeHeader();
+
+    uint32_t liveEnd = static_cast<uint32_t>(usedSectors.size());
+    while (liveEnd > HEADER_SECTORS && !usedSectors[liveEnd - 1])
+        liveEnd--;
+    usedSectors.resize(liveEnd);
+
+    uint64_t liveSize = static_cast<uint64_t>(liveEnd) * SECTOR_SIZE;
+    if (fileSize <= liveSize)
+        return;
+
+    file.close();
+    std::error_code ec;
+    fs::resize_file(filePath, liveSize, ec);
+    file.open(filePath, std::ios::in | std::ios::out | std::ios::binary);
+}
+
 RegionManager::RegionManager(const std::string& worldPath)
     : worldPath(worldPath)
 {
@@ -567,7 +734,51 @@ bool RegionManager::loadChunkData(int cx, int cy, int cz, BlockID* outBlocks)
     return false;
 }
 
-void RegionManager::saveChunkData(int cx, int cy, int cz, const BlockID* blocks)
+// Reads the column once and decodes each requested section it holds into
+// outSections + cy * CHUNK_VOLUME. Returns the mask of sections decoded. With
+// outLight, stored light is decoded the same way and its sections are set in
+// lightLoaded.
+uint32_t RegionManager::loadColumnData(int cx, int cz, uint32_t sections, BlockID* outSections,
+                                       uint8_t* outLight, uint32_t* lightLoaded)
+{
+    if (lightLoaded)
+        *lightLoaded = 0;
+
+    int regX = cx >> REGION_SHIFT;
+    int regZ = cz >> REGION_SHIFT;
+    int localX = cx & REGION_MASK;
+    int localZ = cz & REGION_MASK;
+
+    RegionFile* region = getOrOpenRegion(regX, regZ);
+    if (!region)
+        return 0;
+
+    ColumnData columnData;
+    if (!region->loadColumn(localX, localZ, columnData))
+        return 0;
+
+    uint32_t loaded = 0;
+    for (const auto& section : columnData.sections)
+    {
+        int cy = section.y;
+        if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS || !(sections & (1u << cy)))
+            continue;
+
+        if (!decompressBlocks(section.compressedBlocks, outSections + cy * CHUNK_VOLUME))
+            continue;
+        loaded |= 1u << cy;
+
+        if (outLight && lightLoaded && !section.compressedLight.empty() &&
+            decompressBlocks(section.compressedLight, outLight + cy * CHUNK_VOLUME))
+            *lightLoaded |= 1u << cy;
+    }
+
+    return loaded;
+}
+
+// Light is stored only when given; the blocks codecs work on any byte per
+// voxel, so it is packed with them.
+void RegionManager::saveChunkData(int cx, int cy, int cz, const BlockID* blocks, const uint8_t* light)
 {
     int regX = cx >> REGION_SHIFT;
     int regZ = cz >> REGION_SHIFT;
@@ -586,14 +797,19 @@ void RegionManager::saveChunkData(int cx, int cy, int cz, const BlockID* blocks)
     if (compressedBlocks.empty())
         return;
 
+    std::vector<uint8_t> compressedLight;
+    if (light)
+        compressBlocks(light, compressedLight);
+
     bool found = false;
     for (auto& section : columnData.sections)
     {
         if (section.y == static_cast<int8_t>(cy))
         {
-            if (section.compressedBlocks == compressedBlocks)
+            if (section.compressedBlocks == compressedBlocks && section.compressedLight == compressedLight)
                 return;
             section.compressedBlocks = std::move(compressedBlocks);
+            section.compressedLight = std::move(compressedLight);
             found = true;
             break;
         }
@@ -604,6 +820,7 @@ void RegionManager::saveChunkData(int cx, int cy, int cz, const BlockID* blocks)
         SectionData newSection;
         newSection.y = static_cast<int8_t>(cy);
         newSection.compressedBlocks = std::move(compressedBlocks);
+        newSection.compressedLight = std::move(compressedLight);
         columnData.sections.push_back(std::move(newSection));
 
         std::sort(columnData.sections.begin(), columnData.sections.end(),
@@ -622,6 +839,32 @@ void RegionManager::flush()
     }
 }
 
+// Compacts the open region files in place and every other region file of the
+// world by opening it just for that.
+void RegionManager::compact()
+{
+    std::lock_guard<std::mutex> lock(regionsMutex);
+
+    std::vector<fs::path> openFiles;
+    for (auto& pair : regions)
+    {
+        pair.second->compact();
+        openFiles.push_back(fs::path(getRegionPath(pair.first.x, pair.first.y)).filename());
+    }
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(worldPath, ec))
+    {
+        const fs::path& path = entry.path();
+        if (path.extension() != ".vox" ||
+            std::find(openFiles.begin(), openFiles.end(), path.filename()) != openFiles.end())
+            continue;
+
+        RegionFile region(path.string());
+        region.compact();
+    }
+}
+
 bool RegionManager::loadPlayerData(PlayerData& outData)
 {
     std::string path = worldPath + "/player.dat";
@@ -15,6 +15,13 @@ constexpr int REGION_MASK = REGION_SIZE - 1;
 constexpr int HEADER_ENTRIES = REGION_SIZE * REGION_SIZE;
 constexpr int HEADER_SIZE = HEADER_ENTRIES * 8;
 constexpr int SECTOR_SIZE = 4096;
+constexpr int HEADER_SECTORS = (HEADER_SIZE + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+// Columns start with COLUMN_VERSION_FLAG | version. Columns written before
+// versioning start directly with their section count, which never has the
+// flag set, and carry no light.
+constexpr uint8_t COLUMN_VERSION_FLAG = 0x80;
+constexpr uint8_t COLUMN_FORMAT_VERSION = 1;
 
 using RegionCoord = glm::ivec2;
 using RegionCoordHash = IVec2Hash;
@@ -29,6 +36,9 @@ struct SectionData
 {
     int8_t y;
     std::vector<uint8_t> compressedBlocks;
+    // Packed light in the same encodings as the blocks; empty when the
+    // section was saved before its light settled.
+    std::vector<uint8_t> compressedLight;
 };
 
 struct ColumnData
@@ -45,6 +55,7 @@ public:
     bool loadColumn(int localX, int localZ, ColumnData& outData);
     void saveColumn(int localX, int localZ, const ColumnData& data);
     void flush();
+    void compact();
 
 private:
     std::string filePath;
@@ -52,10 +63,17 @@ private:
     ColumnEntry header[HEADER_ENTRIES];
     bool headerDirty;
     std::mutex mutex;
+    // One flag per sector of the file, set while the header or a column
+    // occupies it in the header on disk. Rebuilt from the header on open.
+    std::vector<bool> usedSectors;
 
     int getEntryIndex(int localX, int localZ) const;
     void readHeader();
     void writeHeader();
+    void writeHeaderEntry(int idx);
+    void buildSectorMap();
+    void setSectors(uint32_t first, uint32_t count, bool used);
+    uint32_t findFreeRun(uint32_t count, uint32_t limit) const;
     uint32_t allocateSectors(uint32_t numBytes);
 };
 
@@ -77,8 +95,11 @@ public:
     ~RegionManager();
 
     bool loadChunkData(int cx, int cy, int cz, BlockID* outBlocks);
-    void saveChunkData(int cx, int cy, int cz, const BlockID* blocks);
+    uint32_t loadColumnData(int cx, int cz, uint32_t sections, BlockID* outSections,
+                            uint8_t* outLight = nullptr, uint32_t* lightLoaded = nullptr);
+    void saveChunkData(int cx, int cy, int cz, const BlockID* blocks, const uint8_t* light = nullptr);
     void flush();
+    void compact();
 
     bool loadPlayerData(PlayerData& outData);
     void savePlayerData(const PlayerData& data);
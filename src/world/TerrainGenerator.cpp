@@ -1,8 +1,14 @@
 #include "TerrainGenerator.h"
 #include "Biome.h"
+#include "CaveGenerator.h"
+#include "NoiseBatch.h"
 #include "../thirdparty/PerlinNoise.hpp"
+#include "../utils/CoordUtils.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 static siv::PerlinNoise::seed_type TERRAIN_SEED = 6767420;
 static siv::PerlinNoise perlin{TERRAIN_SEED};
@@ -14,7 +20,7 @@ constexpr int BASE_HEIGHT = 100;
 constexpr int HEIGHT_VARIATION = 40;
 constexpr int DIRT_DEPTH = 5;
 constexpr int TREE_TRUNK_HEIGHT = 5;
-constexpr int TREE_LEAF_RADIUS = 2;
+constexpr int TREE_LEAF_RADIUS = TREE_SCAN_RADIUS;
 
 constexpr uint8_t BLOCK_AIR = 0;
 constexpr uint8_t BLOCK_DIRT = 1;
@@ -64,75 +70,199 @@ static bool shouldPlaceTree(int worldX, int worldZ, float chance)
     return worldX == treePosX && worldZ == treePosZ;
 }
 
-static BiomeID sampleBiome(float worldX, float worldZ)
+static void sampleClimates(const float* x, const float* z, int count, float* temperature, float* humidity)
 {
-    double temperature = perlinBiomeTemp.octave2D_01(
-        worldX * 0.0015,
-        worldZ * 0.0015,
-        3,
-        0.5
-    );
-
-    double humidity = perlinBiomeHumidity.octave2D_01(
-        worldX * 0.0015,
-        worldZ * 0.0015,
-        3,
-        0.5
-    );
-
-    return pickBiomeFromClimate(
-        static_cast<float>(temperature),
-        static_cast<float>(humidity)
-    );
+    octave2D01Batch(perlinBiomeTemp, x, z, count, 0.0015, 3, 0.5, temperature);
+    octave2D01Batch(perlinBiomeHumidity, x, z, count, 0.0015, 3, 0.5, humidity);
 }
 
-static float sampleTerrainAmplitude(float worldX, float worldZ)
+// Climate and terrain amplitude change over hundreds of blocks, so they are
+// evaluated on a world-aligned lattice every CLIMATE_STEP blocks and bilinearly
+// interpolated in between. Any two callers covering the same block share the
+// same lattice nodes and so agree exactly.
+constexpr int CLIMATE_STEP = 4;
+constexpr int CLIMATE_GRID_NODES = (TREE_SCAN_SIZE + CLIMATE_STEP - 1) / CLIMATE_STEP + 2;
+
+// A node's amplitude blends the biomes at the node and 12 blocks away on
+// each axis.
+constexpr int AMPLITUDE_TAPS = 5;
+constexpr float AMPLITUDE_OFFSET = 12.0f;
+static const float AMPLITUDE_TAP_X[AMPLITUDE_TAPS] = {0.0f, AMPLITUDE_OFFSET, -AMPLITUDE_OFFSET, 0.0f, 0.0f};
+static const float AMPLITUDE_TAP_Z[AMPLITUDE_TAPS] = {0.0f, 0.0f, 0.0f, AMPLITUDE_OFFSET, -AMPLITUDE_OFFSET};
+
+struct ClimateSample
 {
-    constexpr float SAMPLE_OFFSET = 12.0f;
-    BiomeID b0 = sampleBiome(worldX, worldZ);
-    BiomeID b1 = sampleBiome(worldX + SAMPLE_OFFSET, worldZ);
-    BiomeID b2 = sampleBiome(worldX - SAMPLE_OFFSET, worldZ);
-    BiomeID b3 = sampleBiome(worldX, worldZ + SAMPLE_OFFSET);
-    BiomeID b4 = sampleBiome(worldX, worldZ - SAMPLE_OFFSET);
-
-    float a0 = getBiomeDefinition(b0).terrainAmplitude;
-    float a1 = getBiomeDefinition(b1).terrainAmplitude;
-    float a2 = getBiomeDefinition(b2).terrainAmplitude;
-    float a3 = getBiomeDefinition(b3).terrainAmplitude;
-    float a4 = getBiomeDefinition(b4).terrainAmplitude;
-
-    return a0 * 0.5f + (a1 + a2 + a3 + a4) * 0.125f;
+    float temperature;
+    float humidity;
+    float amplitude;
+};
+
+static int floorDiv(int v, int d)
+{
+    return v >= 0 ? v / d : (v - d + 1) / d;
+}
+
+static bool exactClimateSampling = false;
+
+// Climate and amplitude of one block straight from siv::PerlinNoise, as they
+// were computed before the lattice; the reference the lattice is checked against.
+static ClimateSample exactClimateSample(int worldX, int worldZ)
+{
+    float amplitudes[AMPLITUDE_TAPS];
+    ClimateSample result{};
+    for (int t = 0; t < AMPLITUDE_TAPS; t++)
+    {
+        double x = (static_cast<float>(worldX) + AMPLITUDE_TAP_X[t]) * 0.0015;
+        double z = (static_cast<float>(worldZ) + AMPLITUDE_TAP_Z[t]) * 0.0015;
+        float temperature = static_cast<float>(perlinBiomeTemp.octave2D_01(x, z, 3, 0.5));
+        float humidity = static_cast<float>(perlinBiomeHumidity.octave2D_01(x, z, 3, 0.5));
+        amplitudes[t] = getBiomeDefinition(pickBiomeFromClimate(temperature, humidity)).terrainAmplitude;
+        if (t == 0)
+        {
+            result.temperature = temperature;
+            result.humidity = humidity;
+        }
+    }
+    result.amplitude = amplitudes[0] * 0.5f +
+                       (amplitudes[1] + amplitudes[2] + amplitudes[3] + amplitudes[4]) * 0.125f;
+    return result;
+}
+
+class ClimateGrid
+{
+public:
+    // Covers the blocks [minX, maxX] x [minZ, maxZ].
+    ClimateGrid(int minX, int minZ, int maxX, int maxZ)
+        : exact(exactClimateSampling)
+    {
+        if (exact)
+            return;
+
+        nodeX0 = floorDiv(minX, CLIMATE_STEP);
+        nodeZ0 = floorDiv(minZ, CLIMATE_STEP);
+        nodesX = floorDiv(maxX, CLIMATE_STEP) - nodeX0 + 2;
+        nodesZ = floorDiv(maxZ, CLIMATE_STEP) - nodeZ0 + 2;
+
+        constexpr int MAX_TAPS = CLIMATE_GRID_NODES * CLIMATE_GRID_NODES * AMPLITUDE_TAPS;
+        float tapX[MAX_TAPS];
+        float tapZ[MAX_TAPS];
+        float temperature[MAX_TAPS];
+        float humidity[MAX_TAPS];
+
+        int taps = 0;
+        for (int z = 0; z < nodesZ; z++)
+        {
+            for (int x = 0; x < nodesX; x++)
+            {
+                float worldX = static_cast<float>((nodeX0 + x) * CLIMATE_STEP);
+                float worldZ = static_cast<float>((nodeZ0 + z) * CLIMATE_STEP);
+                for (int t = 0; t < AMPLITUDE_TAPS; t++)
+                {
+                    tapX[taps] = worldX + AMPLITUDE_TAP_X[t];
+                    tapZ[taps] = worldZ + AMPLITUDE_TAP_Z[t];
+                    taps++;
+                }
+            }
+        }
+        sampleClimates(tapX, tapZ, taps, temperature, humidity);
+
+        int tap = 0;
+        for (int z = 0; z < nodesZ; z++)
+        {
+            for (int x = 0; x < nodesX; x++)
+            {
+                float amplitudes[AMPLITUDE_TAPS];
+                for (int t = 0; t < AMPLITUDE_TAPS; t++)
+                {
+                    BiomeID biome = pickBiomeFromClimate(temperature[tap + t], humidity[tap + t]);
+                    amplitudes[t] = getBiomeDefinition(biome).terrainAmplitude;
+                }
+
+                ClimateSample& node = nodes[z * CLIMATE_GRID_NODES + x];
+                node.temperature = temperature[tap];
+                node.humidity = humidity[tap];
+                node.amplitude = amplitudes[0] * 0.5f +
+                                 (amplitudes[1] + amplitudes[2] + amplitudes[3] + amplitudes[4]) * 0.125f;
+                tap += AMPLITUDE_TAPS;
+            }
+        }
+    }
+
+    ClimateSample sample(int worldX, int worldZ) const
+    {
+        if (exact)
+            return exactClimateSample(worldX, worldZ);
+
+        int nodeX = floorDiv(worldX, CLIMATE_STEP);
+        int nodeZ = floorDiv(worldZ, CLIMATE_STEP);
+        float fx = static_cast<float>(worldX - nodeX * CLIMATE_STEP) / CLIMATE_STEP;
+        float fz = static_cast<float>(worldZ - nodeZ * CLIMATE_STEP) / CLIMATE_STEP;
+
+        const ClimateSample* row = &nodes[(nodeZ - nodeZ0) * CLIMATE_GRID_NODES + (nodeX - nodeX0)];
+        const ClimateSample& s00 = row[0];
+        const ClimateSample& s10 = row[1];
+        const ClimateSample& s01 = row[CLIMATE_GRID_NODES];
+        const ClimateSample& s11 = row[CLIMATE_GRID_NODES + 1];
+
+        auto lerp2 = [fx, fz](float a, float b, float c, float d)
+        {
+            float top = a + (b - a) * fx;
+            float bottom = c + (d - c) * fx;
+            return top + (bottom - top) * fz;
+        };
+
+        ClimateSample result;
+        result.temperature = lerp2(s00.temperature, s10.temperature, s01.temperature, s11.temperature);
+        result.humidity = lerp2(s00.humidity, s10.humidity, s01.humidity, s11.humidity);
+        result.amplitude = lerp2(s00.amplitude, s10.amplitude, s01.amplitude, s11.amplitude);
+        return result;
+    }
+
+private:
+    bool exact;
+    int nodeX0, nodeZ0;
+    int nodesX, nodesZ;
+    ClimateSample nodes[CLIMATE_GRID_NODES * CLIMATE_GRID_NODES];
+};
+
+static BiomeID biomeOf(const ClimateSample& climate)
+{
+    return pickBiomeFromClimate(climate.temperature, climate.humidity);
+}
+
+static void getTerrainHeights(const float* x, const float* z, const float* terrainAmplitude, int count, int* out)
+{
+    constexpr int MAX_POINTS = CHUNK_SIZE * CHUNK_SIZE;
+    float continentNoise[MAX_POINTS];
+    float hillNoise[MAX_POINTS];
+    float detailNoise[MAX_POINTS];
+
+    for (int start = 0; start < count; start += MAX_POINTS)
+    {
+        int n = (std::min)(MAX_POINTS, count - start);
+        octave2D01Batch(perlin, x + start, z + start, n, 0.002, 2, 0.5, continentNoise);
+        octave2D01Batch(perlin, x + start, z + start, n, 0.01, 4, 0.45, hillNoise);
+        octave2D01Batch(perlinDetail, x + start, z + start, n, 0.05, 2, 0.5, detailNoise);
+
+        for (int i = 0; i < n; i++)
+        {
+            double continent = std::pow(static_cast<double>(continentNoise[i]), 1.2);
+            double blendedNoise = continent * 0.4 + hillNoise[i] * 0.5 + detailNoise[i] * 0.1;
+            blendedNoise = blendedNoise * blendedNoise * (3.0 - 2.0 * blendedNoise);
+
+            double height = BASE_HEIGHT + blendedNoise * (HEIGHT_VARIATION * terrainAmplitude[start + i]);
+            out[start + i] = static_cast<int>(std::round(height));
+        }
+    }
 }
 
-static double getTerrainHeight(float worldX, float worldZ, float terrainAmplitude)
+static int getTerrainHeight(int worldX, int worldZ, float terrainAmplitude)
 {
-    double continentNoise = perlin.octave2D_01(
-        worldX * 0.002,
-        worldZ * 0.002,
-        2,
-        0.5
-    );
-
-    continentNoise = std::pow(continentNoise, 1.2);
-
-    double hillNoise = perlin.octave2D_01(
-        worldX * 0.01,
-        worldZ * 0.01,
-        4,
-        0.45
-    );
-
-    double detailNoise = perlinDetail.octave2D_01(
-        worldX * 0.05,
-        worldZ * 0.05,
-        2,
-        0.5
-    );
-
-    double blendedNoise = continentNoise * 0.4 + hillNoise * 0.5 + detailNoise * 0.1;
-    blendedNoise = blendedNoise * blendedNoise * (3.0 - 2.0 * blendedNoise);
-
-    return BASE_HEIGHT + blendedNoise * (HEIGHT_VARIATION * terrainAmplitude);
+    float x = static_cast<float>(worldX);
+    float z = static_cast<float>(worldZ);
+    int height;
+    getTerrainHeights(&x, &z, &terrainAmplitude, 1, &height);
+    return height;
 }
 
 static void setBlockIfInChunk(BlockID* blocks, int localX, int localY, int localZ, uint8_t blockId, bool overwriteSolid = false)
@@ -149,40 +279,196 @@ static void setBlockIfInChunk(BlockID* blocks, int localX, int localY, int local
     }
 }
 
-void generateTerrain(BlockID* blocks, int cx, int cy, int cz)
+static void computeColumnMaps(int cx, int cz, ColumnMaps& out)
 {
     int worldOffsetX = cx * CHUNK_SIZE;
-    int worldOffsetY = cy * CHUNK_SIZE;
     int worldOffsetZ = cz * CHUNK_SIZE;
+    ClimateGrid climate(worldOffsetX, worldOffsetZ,
+                        worldOffsetX + CHUNK_SIZE - 1, worldOffsetZ + CHUNK_SIZE - 1);
 
-    for (int x = 0; x < CHUNK_SIZE; x++)
+    constexpr int COLUMNS = CHUNK_SIZE * CHUNK_SIZE;
+    float worldX[COLUMNS];
+    float worldZ[COLUMNS];
+    float amplitudes[COLUMNS];
+
+    for (int z = 0; z < CHUNK_SIZE; z++)
     {
-        for (int z = 0; z < CHUNK_SIZE; z++)
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            int column = z * CHUNK_SIZE + x;
+            ClimateSample sample = climate.sample(worldOffsetX + x, worldOffsetZ + z);
+            worldX[column] = static_cast<float>(worldOffsetX + x);
+            worldZ[column] = static_cast<float>(worldOffsetZ + z);
+            amplitudes[column] = sample.amplitude;
+            out.biomes[column] = biomeOf(sample);
+        }
+    }
+
+    getTerrainHeights(worldX, worldZ, amplitudes, COLUMNS, out.heights);
+}
+
+// Not bounded here: ChunkManager evicts columns as they leave the streaming
+// range, so the cache holds at most the loaded area plus columns computed for
+// work still in flight.
+static std::mutex columnCacheMutex;
+static std::unordered_map<glm::ivec2, std::shared_ptr<const ColumnMaps>, IVec2Hash> columnCache;
+static size_t columnMapsAllocations = 0;
+
+std::shared_ptr<const ColumnMaps> findColumnMaps(int cx, int cz)
+{
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    auto it = columnCache.find(glm::ivec2(cx, cz));
+    return it != columnCache.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const ColumnMaps> getColumnMaps(int cx, int cz)
+{
+    if (std::shared_ptr<const ColumnMaps> cached = findColumnMaps(cx, cz))
+        return cached;
+
+    // Computed outside the lock; if another thread got there first its maps win.
+    auto maps = std::make_shared<ColumnMaps>();
+    computeColumnMaps(cx, cz, *maps);
+
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    columnMapsAllocations++;
+    return columnCache.try_emplace(glm::ivec2(cx, cz), std::move(maps)).first->second;
+}
+
+void evictColumnMapsOutside(int centerX, int centerZ, int radius)
+{
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    for (auto it = columnCache.begin(); it != columnCache.end();)
+    {
+        if (std::abs(it->first.x - centerX) > radius || std::abs(it->first.y - centerZ) > radius)
+            it = columnCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void clearColumnMaps()
+{
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    columnCache.clear();
+}
+
+size_t columnMapsCount()
+{
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    return columnCache.size();
+}
+
+size_t columnMapsAllocationCount()
+{
+    std::lock_guard<std::mutex> lock(columnCacheMutex);
+    return columnMapsAllocations;
+}
+
+static int treeTrunkHeight(TreeType type)
+{
+    return type == TreeType::Spruce ? TREE_TRUNK_HEIGHT + 1 : TREE_TRUNK_HEIGHT;
+}
+
+void computeColumnTerrain(int cx, int cz, ColumnTerrain& out)
+{
+    int worldOffsetX = cx * CHUNK_SIZE;
+    int worldOffsetZ = cz * CHUNK_SIZE;
+    out.cx = cx;
+    out.cz = cz;
+    out.maps = getColumnMaps(cx, cz);
+    const ColumnMaps& maps = *out.maps;
+
+    out.minHeight = *std::min_element(std::begin(maps.heights), std::end(maps.heights));
+    out.maxHeight = *std::max_element(std::begin(maps.heights), std::end(maps.heights));
+    out.topY = out.maxHeight;
+
+    for (int column = 0; column < CHUNK_SIZE * CHUNK_SIZE; column++)
+    {
+        BiomeID biomeId = maps.biomes[column];
+        const BiomeDefinition& biome = getBiomeDefinition(biomeId);
+        int terrainHeight = maps.heights[column];
+        uint8_t surfaceBlock = biome.surfaceBlock;
+        uint8_t fillerBlock = biome.fillerBlock;
+        if (terrainHeight < SEA_LEVEL)
+        {
+            surfaceBlock = biome.fillerBlock;
+        }
+
+        int beachMaxHeight = biomeId == BiomeID::Plains ? SEA_LEVEL : SEA_LEVEL + 1;
+        bool isBeachColumn = biomeId != BiomeID::Desert &&
+                             terrainHeight >= SEA_LEVEL - 1 &&
+                             terrainHeight <= beachMaxHeight;
+        if (isBeachColumn)
         {
-            float worldX = static_cast<float>(worldOffsetX + x);
-            float worldZ = static_cast<float>(worldOffsetZ + z);
+            surfaceBlock = BLOCK_SAND;
+            fillerBlock = BLOCK_SAND;
+        }
 
-            BiomeID biomeId = sampleBiome(worldX, worldZ);
+        out.surfaceBlocks[column] = surfaceBlock;
+        out.fillerBlocks[column] = fillerBlock;
+    }
+
+    ClimateGrid climate(worldOffsetX - TREE_SCAN_RADIUS, worldOffsetZ - TREE_SCAN_RADIUS,
+                        worldOffsetX + CHUNK_SIZE + TREE_SCAN_RADIUS - 1,
+                        worldOffsetZ + CHUNK_SIZE + TREE_SCAN_RADIUS - 1);
+
+    out.treeCount = 0;
+    for (int x = -TREE_SCAN_RADIUS; x < CHUNK_SIZE + TREE_SCAN_RADIUS; x++)
+    {
+        for (int z = -TREE_SCAN_RADIUS; z < CHUNK_SIZE + TREE_SCAN_RADIUS; z++)
+        {
+            int worldX = worldOffsetX + x;
+            int worldZ = worldOffsetZ + z;
+            bool inside = x >= 0 && x < CHUNK_SIZE && z >= 0 && z < CHUNK_SIZE;
+
+            BiomeID biomeId = inside
+                ? maps.biomes[z * CHUNK_SIZE + x]
+                : biomeOf(climate.sample(worldX, worldZ));
             const BiomeDefinition& biome = getBiomeDefinition(biomeId);
-            float terrainAmplitude = sampleTerrainAmplitude(worldX, worldZ);
-            int terrainHeight = static_cast<int>(std::round(getTerrainHeight(worldX, worldZ, terrainAmplitude)));
-            uint8_t surfaceBlock = biome.surfaceBlock;
-            uint8_t fillerBlock = biome.fillerBlock;
-            if (terrainHeight < SEA_LEVEL)
+
+            if (biome.treeType == TreeType::None)
+                continue;
+
+            if (!shouldPlaceTree(worldX, worldZ, TREE_SPAWN_CHANCE * biome.treeDensity))
+                continue;
+
+            int terrainHeight;
+            if (inside)
             {
-                surfaceBlock = biome.fillerBlock;
+                terrainHeight = maps.heights[z * CHUNK_SIZE + x];
             }
-
-            int beachMaxHeight = biomeId == BiomeID::Plains ? SEA_LEVEL : SEA_LEVEL + 1;
-            bool isBeachColumn = biomeId != BiomeID::Desert &&
-                                 terrainHeight >= SEA_LEVEL - 1 &&
-                                 terrainHeight <= beachMaxHeight;
-            if (isBeachColumn)
+            else
             {
-                surfaceBlock = BLOCK_SAND;
-                fillerBlock = BLOCK_SAND;
+                terrainHeight = getTerrainHeight(worldX, worldZ, climate.sample(worldX, worldZ).amplitude);
             }
 
+            if (terrainHeight <= SEA_LEVEL + 2)
+                continue;
+
+            ColumnTerrain::Tree& tree = out.trees[out.treeCount++];
+            tree.x = static_cast<int8_t>(x);
+            tree.z = static_cast<int8_t>(z);
+            tree.baseY = static_cast<int16_t>(terrainHeight + 1);
+            tree.type = biome.treeType;
+            out.topY = (std::max)(out.topY, tree.baseY + treeTrunkHeight(tree.type) - 1 + TREE_LEAF_RADIUS);
+        }
+    }
+}
+
+void generateTerrain(BlockID* blocks, const ColumnTerrain& column, int cy)
+{
+    int worldOffsetY = cy * CHUNK_SIZE;
+
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            int columnIndex = z * CHUNK_SIZE + x;
+            int terrainHeight = column.maps->heights[columnIndex];
+            uint8_t surfaceBlock = column.surfaceBlocks[columnIndex];
+            uint8_t fillerBlock = column.fillerBlocks[columnIndex];
+
             for (int y = 0; y < CHUNK_SIZE; y++)
             {
                 int worldY = worldOffsetY + y;
@@ -215,104 +501,124 @@ void generateTerrain(BlockID* blocks, int cx, int cy, int cz)
         }
     }
 
-    for (int x = -TREE_LEAF_RADIUS; x < CHUNK_SIZE + TREE_LEAF_RADIUS; x++)
+    for (int t = 0; t < column.treeCount; t++)
     {
-        for (int z = -TREE_LEAF_RADIUS; z < CHUNK_SIZE + TREE_LEAF_RADIUS; z++)
-        {
-            int worldX = worldOffsetX + x;
-            int worldZ = worldOffsetZ + z;
-
-            BiomeID biomeId = sampleBiome(static_cast<float>(worldX), static_cast<float>(worldZ));
-            const BiomeDefinition& biome = getBiomeDefinition(biomeId);
-
-            if (biome.treeType == TreeType::None)
-                continue;
+        const ColumnTerrain::Tree& tree = column.trees[t];
 
-            if (!shouldPlaceTree(worldX, worldZ, TREE_SPAWN_CHANCE * biome.treeDensity))
-                continue;
-
-            float terrainAmplitude = sampleTerrainAmplitude(
-                static_cast<float>(worldX), static_cast<float>(worldZ));
-            int terrainHeight = static_cast<int>(std::round(getTerrainHeight(
-                static_cast<float>(worldX), static_cast<float>(worldZ), terrainAmplitude)));
-
-            if (terrainHeight <= SEA_LEVEL + 2)
-                continue;
+        uint8_t logBlock = BLOCK_OAK_LOG;
+        uint8_t leafBlock = BLOCK_OAK_LEAVES;
+        if (tree.type == TreeType::Spruce)
+        {
+            logBlock = BLOCK_SPRUCE_LOG;
+            leafBlock = BLOCK_SPRUCE_LEAVES;
+        }
 
-            uint8_t logBlock = BLOCK_OAK_LOG;
-            uint8_t leafBlock = BLOCK_OAK_LEAVES;
-            if (biome.treeType == TreeType::Spruce)
-            {
-                logBlock = BLOCK_SPRUCE_LOG;
-                leafBlock = BLOCK_SPRUCE_LEAVES;
-            }
+        int treeBaseY = tree.baseY;
+        int trunkHeight = treeTrunkHeight(tree.type);
 
-            int treeBaseY = terrainHeight + 1;
-            int trunkHeight = TREE_TRUNK_HEIGHT;
-            if (biome.treeType == TreeType::Spruce)
-            {
-                trunkHeight = TREE_TRUNK_HEIGHT + 1;
-            }
+        int leafCenterY = treeBaseY + trunkHeight - 1;
+        if (leafCenterY + TREE_LEAF_RADIUS < worldOffsetY || treeBaseY >= worldOffsetY + CHUNK_SIZE)
+            continue;
 
-            for (int ty = 0; ty < trunkHeight; ty++)
-            {
-                int localX = x;
-                int localY = treeBaseY + ty - worldOffsetY;
-                int localZ = z;
-                setBlockIfInChunk(blocks, localX, localY, localZ, logBlock, true);
-            }
+        for (int ty = 0; ty < trunkHeight; ty++)
+        {
+            int localX = tree.x;
+            int localY = treeBaseY + ty - worldOffsetY;
+            int localZ = tree.z;
+            setBlockIfInChunk(blocks, localX, localY, localZ, logBlock, true);
+        }
 
-            int leafCenterY = treeBaseY + trunkHeight - 1;
-            for (int lx = -TREE_LEAF_RADIUS; lx <= TREE_LEAF_RADIUS; lx++)
+        for (int lx = -TREE_LEAF_RADIUS; lx <= TREE_LEAF_RADIUS; lx++)
+        {
+            for (int ly = -1; ly <= TREE_LEAF_RADIUS; ly++)
             {
-                for (int ly = -1; ly <= TREE_LEAF_RADIUS; ly++)
+                for (int lz = -TREE_LEAF_RADIUS; lz <= TREE_LEAF_RADIUS; lz++)
                 {
-                    for (int lz = -TREE_LEAF_RADIUS; lz <= TREE_LEAF_RADIUS; lz++)
-                    {
-                        int dist = std::abs(lx) + std::abs(ly) + std::abs(lz);
-                        if (dist > TREE_LEAF_RADIUS + 1)
-                            continue;
+                    int dist = std::abs(lx) + std::abs(ly) + std::abs(lz);
+                    if (dist > TREE_LEAF_RADIUS + 1)
+                        continue;
 
-                        if (lx == 0 && lz == 0 && ly < TREE_LEAF_RADIUS)
-                            continue;
+                    if (lx == 0 && lz == 0 && ly < TREE_LEAF_RADIUS)
+                        continue;
 
-                        int localX = x + lx;
-                        int localY = leafCenterY + ly - worldOffsetY;
-                        int localZ = z + lz;
-                        setBlockIfInChunk(blocks, localX, localY, localZ, leafBlock);
-                    }
+                    int localX = tree.x + lx;
+                    int localY = leafCenterY + ly - worldOffsetY;
+                    int localZ = tree.z + lz;
+                    setBlockIfInChunk(blocks, localX, localY, localZ, leafBlock);
                 }
             }
         }
     }
 }
 
+bool uniformSection(const ColumnTerrain& column, int cy, BlockID& block)
+{
+    int bottomY = cy * CHUNK_SIZE;
+    int topY = bottomY + CHUNK_SIZE - 1;
+
+    if (bottomY > column.topY)
+    {
+        if (bottomY > SEA_LEVEL)
+            block = BLOCK_AIR;
+        else if (topY <= SEA_LEVEL)
+            block = BLOCK_WATER;
+        else
+            return false;
+        return true;
+    }
+
+    if (topY <= column.minHeight - DIRT_DEPTH && !sectionMayHaveCaves(cy, column.maxHeight))
+    {
+        block = BLOCK_STONE;
+        return true;
+    }
+    return false;
+}
+
+void generateTerrain(BlockID* blocks, int cx, int cy, int cz)
+{
+    ColumnTerrain column;
+    computeColumnTerrain(cx, cz, column);
+    generateTerrain(blocks, column, cy);
+}
+
+static int columnIndexOf(int worldX, int worldZ)
+{
+    return (worldZ - floorDiv(worldZ, CHUNK_SIZE) * CHUNK_SIZE) * CHUNK_SIZE +
+           (worldX - floorDiv(worldX, CHUNK_SIZE) * CHUNK_SIZE);
+}
+
 BiomeID getBiomeAt(int worldX, int worldZ)
 {
-    return sampleBiome(static_cast<float>(worldX), static_cast<float>(worldZ));
+    if (auto maps = findColumnMaps(floorDiv(worldX, CHUNK_SIZE), floorDiv(worldZ, CHUNK_SIZE)))
+        return maps->biomes[columnIndexOf(worldX, worldZ)];
+    return biomeOf(ClimateGrid(worldX, worldZ, worldX, worldZ).sample(worldX, worldZ));
 }
 
 int getTerrainHeightAt(int worldX, int worldZ)
 {
-    float terrainAmplitude = sampleTerrainAmplitude(
-        static_cast<float>(worldX), static_cast<float>(worldZ));
+    if (auto maps = findColumnMaps(floorDiv(worldX, CHUNK_SIZE), floorDiv(worldZ, CHUNK_SIZE)))
+        return maps->heights[columnIndexOf(worldX, worldZ)];
+
+    float terrainAmplitude = ClimateGrid(worldX, worldZ, worldX, worldZ).sample(worldX, worldZ).amplitude;
+    return getTerrainHeight(worldX, worldZ, terrainAmplitude);
+}
 
-    return static_cast<int>(std::round(getTerrainHeight(
-        static_cast<float>(worldX), static_cast<float>(worldZ), terrainAmplitude)));
+float getTerrainAmplitudeAt(int worldX, int worldZ)
+{
+    return ClimateGrid(worldX, worldZ, worldX, worldZ).sample(worldX, worldZ).amplitude;
+}
+
+void setExactClimateSampling(bool exact)
+{
+    exactClimateSampling = exact;
+    clearColumnMaps();
 }
 
 void getTerrainHeightsForChunk(int cx, int cz, int* outHeights)
 {
-    int baseX = cx * CHUNK_SIZE;
-    int baseZ = cz * CHUNK_SIZE;
-    
-    for (int z = 0; z < CHUNK_SIZE; ++z)
-    {
-        for (int x = 0; x < CHUNK_SIZE; ++x)
-        {
-            outHeights[z * CHUNK_SIZE + x] = getTerrainHeightAt(baseX + x, baseZ + z);
-        }
-    }
+    std::shared_ptr<const ColumnMaps> maps = getColumnMaps(cx, cz);
+    std::copy(std::begin(maps->heights), std::end(maps->heights), outHeights);
 }
 
 uint32_t getWorldSeed()
@@ -327,4 +633,5 @@ void setWorldSeed(uint32_t seed)
     perlinDetail.reseed(TERRAIN_SEED + 1);
     perlinBiomeTemp.reseed(TERRAIN_SEED + 3);
     perlinBiomeHumidity.reseed(TERRAIN_SEED + 4);
+    clearColumnMaps();
 }
\ No newline at end of file
@@ -1,16 +1,83 @@
 #pragma once
 #include "Chunk.h"
 #include "Biome.h"
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 
 uint32_t getWorldSeed();
 void setWorldSeed(uint32_t seed);
 
+// Height and biome maps of one column, indexed z * CHUNK_SIZE + x like
+// getTerrainHeightsForChunk.
+struct ColumnMaps
+{
+    int heights[CHUNK_SIZE * CHUNK_SIZE];
+    BiomeID biomes[CHUNK_SIZE * CHUNK_SIZE];
+};
+
+// Column maps are cached per (cx, cz) so cave carving, meshing and tinting read
+// arrays instead of evaluating noise. getColumnMaps computes and caches a
+// missing column; findColumnMaps only looks. Both are safe to call from
+// workers, and a returned map stays valid after its column is evicted.
+// evictColumnMapsOutside drops every column farther than radius from the
+// center on either axis.
+std::shared_ptr<const ColumnMaps> getColumnMaps(int cx, int cz);
+std::shared_ptr<const ColumnMaps> findColumnMaps(int cx, int cz);
+void evictColumnMapsOutside(int centerX, int centerZ, int radius);
+void clearColumnMaps();
+size_t columnMapsCount();
+// Maps ever allocated, including ones dropped because another thread cached
+// the same column first.
+size_t columnMapsAllocationCount();
+
+constexpr int TREE_SCAN_RADIUS = 2;
+constexpr int TREE_SCAN_SIZE = CHUNK_SIZE + 2 * TREE_SCAN_RADIUS;
+
+// 2D terrain fields for one chunk column. They are computed once and shared
+// by every section generated from the column.
+struct ColumnTerrain
+{
+    struct Tree
+    {
+        int8_t x, z;
+        int16_t baseY;
+        TreeType type;
+    };
+
+    int cx = 0;
+    int cz = 0;
+    std::shared_ptr<const ColumnMaps> maps;
+    uint8_t surfaceBlocks[CHUNK_SIZE * CHUNK_SIZE];
+    uint8_t fillerBlocks[CHUNK_SIZE * CHUNK_SIZE];
+    // Trees rooted within TREE_SCAN_RADIUS of the column, in placement order.
+    Tree trees[TREE_SCAN_SIZE * TREE_SCAN_SIZE];
+    int treeCount = 0;
+    // Lowest and highest surface, and the highest block terrain or trees place.
+    int minHeight = 0;
+    int maxHeight = 0;
+    int topY = 0;
+};
+
+void computeColumnTerrain(int cx, int cz, ColumnTerrain& out);
+void generateTerrain(BlockID* blocks, const ColumnTerrain& column, int cy);
+// True when generating section cy and carving its caves would leave every
+// voxel as the same block, which is returned in block. Callers then store the
+// section uniform and skip generateTerrain and applyCavesToBlocks for it.
+bool uniformSection(const ColumnTerrain& column, int cy, BlockID& block);
 void generateTerrain(BlockID* blocks, int cx, int cy, int cz);
 
 BiomeID getBiomeAt(int worldX, int worldZ);
 
 int getTerrainHeightAt(int worldX, int worldZ);
+// Biome-blended terrain amplitude at one block, never read from the cache.
+float getTerrainAmplitudeAt(int worldX, int worldZ);
+
+// Evaluates climate and terrain amplitude exactly at every block instead of
+// interpolating the coarse lattice, as generation did before it. A reference
+// for tools/ClimateLattice; clears the column cache and must not be switched
+// while workers generate.
+void setExactClimateSampling(bool exact);
 
 void getTerrainHeightsForChunk(int cx, int cz, int* outHeights);
 